@@ -0,0 +1,25 @@
+#include "activity.h"
+#include <algorithm>
+
+size_t ticks_to_contact(const NPC &a, const NPC &b)
+{
+    bool aKills = can_kill(a.get_type(), b.get_type());
+    bool bKills = can_kill(b.get_type(), a.get_type());
+    if (!aKills && !bKills) return NO_CONTACT;
+
+    double reach = std::max(aKills ? (double)a.get_range() : 0.0, bKills ? (double)b.get_range() : 0.0);
+    auto [bx, by] = b.position();
+    auto [ax, ay] = a.position();
+    double gap = std::sqrt(std::pow(ax - bx, 2) + std::pow(ay - by, 2)) - reach;
+    if (gap <= 0) return 0;
+
+    // За тик расстояние сокращается не больше, чем на сумму скоростей.
+    size_t closing = std::max<size_t>(1, a.get_speed() + b.get_speed());
+    return (size_t)(gap / closing);
+}
+
+size_t sleep_ticks_for(size_t quietTicks)
+{
+    if (quietTicks < SLEEP_MIN_TICKS) return 0;
+    return std::min(quietTicks, SLEEP_MAX_TICKS);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "npc.h"
+#include <limits>
+
+// Острова активности: NPC, рядом с которым никто не может ни убить его, ни
+// погибнуть от него, засыпает и не ищет соседей, пока не истечёт
+// гарантированно спокойное время или кто-то не подойдёт близко. Сон не
+// дольше паузы, которую взяло поведение NPC, так что погоню он не прерывает,
+// а бездействующий NPC ничего не стоит.
+
+constexpr size_t NO_CONTACT = std::numeric_limits<size_t>::max();
+constexpr size_t SLEEP_MIN_TICKS = 4;
+constexpr size_t SLEEP_MAX_TICKS = 64;
+
+// Сколько тиков пара a, b в худшем случае не сможет вступить в смертельный бой.
+size_t ticks_to_contact(const NPC &a, const NPC &b);
+
+// На сколько тиков можно усыпить NPC, зная ближайший до контакта срок (0 - нельзя).
+size_t sleep_ticks_for(size_t quietTicks);
@@ -1,28 +1,69 @@
 #include "battleManager.h"
+#include "populationStats.h"
+#include "observerRegistry.h"
+#include <array>
+#include <cstdint>
+#include <random>
 
 std::queue<BattleTask> battleTasks;
 std::mutex battleTasksMutex;
+std::atomic<size_t> battleTick{0};
 
-void completeBattle(const BattleTask& task)
+void roll_dice_batch(int *out, size_t n)
 {
-    auto attacker = task.attacker;
-    auto defender = task.defender;
+    // splitmix64: состояние сдвигается на константу, поэтому цикл не зависит
+    // от предыдущей итерации и векторизуется.
+    static thread_local uint64_t seed = std::random_device{}();
+    uint64_t base = seed;
+    seed += n * 0x9E3779B97F4A7C15ull;
 
-    if (!attacker->is_alive() || !defender->is_alive()) {
-        return;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t z = base + (i + 1) * 0x9E3779B97F4A7C15ull;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        out[i] = (int)(((z >> 32) * 6) >> 32);
     }
+}
 
-    if (defender->accept(attacker)) {
-        int attack = attacker->roll_dice();
-        int defense = defender->roll_dice();
+void completeBattles(const std::vector<BattleTask> &tasks)
+{
+    constexpr size_t TYPES = VihuholType + 1;
+    std::array<std::vector<size_t>, TYPES * TYPES> buckets;
+
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        NpcType a = tasks[i].attacker->get_type();
+        NpcType d = tasks[i].defender->get_type();
+        buckets[a * TYPES + d].push_back(i);
+    }
+
+    // Для каждой задачи: -1 - убить нельзя, иначе 1/0 - успешна ли атака.
+    std::vector<int8_t> outcome(tasks.size(), -1);
+    std::vector<int> dice;
+
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        const auto &bucket = buckets[b];
+        if (bucket.empty() || !can_kill(NpcType(b / TYPES), NpcType(b % TYPES))) continue;
+
+        dice.resize(bucket.size() * 2);
+        roll_dice_batch(dice.data(), dice.size());
+        for (size_t k = 0; k < bucket.size(); ++k) {
+            outcome[bucket[k]] = dice[2 * k] > dice[2 * k + 1];
+        }
+    }
+
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        const auto &attacker = tasks[i].attacker;
+        const auto &defender = tasks[i].defender;
 
-        bool success = (attack > defense);
+        if (!attacker->is_alive() || !defender->is_alive()) continue;
 
-        if (success) {
+        if (outcome[i] == 1) {
             defender->die();
-            attacker->fight_notify(defender, true);
-        } else {
-            attacker->fight_notify(defender, false);
+            populationStats.on_kill(attacker->get_type());
+            attacker->fight_notify(defender, true, tasks[i].where);
+        } else if (outcome[i] == 0 || fightObservers.has_listeners(attacker->get_type(), false)) {
+            attacker->fight_notify(defender, false, tasks[i].where);
         }
     }
-}
\ No newline at end of file
+}
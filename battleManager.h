@@ -1,12 +1,30 @@
+#pragma once
 #include "npc.h"
 #include <queue>
+#include <vector>
 
 struct BattleTask {
+    BattleTask() = default;
+    // Позиции запоминаются при создании задачи, то есть когда бой обнаружен.
+    BattleTask(std::shared_ptr<NPC> attacker, std::shared_ptr<NPC> defender)
+        : attacker(std::move(attacker)), defender(std::move(defender)),
+          where{this->attacker->position(), this->defender->position()} {}
+
     std::shared_ptr<NPC> attacker;
     std::shared_ptr<NPC> defender;
+    FightPositions where;
 };
 
 extern std::queue<BattleTask> battleTasks;
 extern std::mutex battleTasksMutex;
+// Тик, бои которого сейчас разрешаются.
+extern std::atomic<size_t> battleTick;
+
+// Кидает n шестигранных кубиков (0..5) за один проход по массиву.
+void roll_dice_batch(int *out, size_t n);
 
-void completeBattle(const BattleTask& task);
\ No newline at end of file
+// Пакетное разрешение боёв одного тика. Задачи раскладываются по парам типов,
+// пары, в которых убийство невозможно, отбрасываются целиком, кубики для
+// остальных кидаются пачкой, а смерти применяются одним проходом в исходном
+// порядке - так NPC, которого атакуют несколько раз, погибает ровно один раз.
+void completeBattles(const std::vector<BattleTask> &tasks);
\ No newline at end of file
@@ -0,0 +1,243 @@
+#include "behaviour.h"
+#include "kinematics.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+constexpr int MAX_NPC_SPEED = 50;
+constexpr size_t IDLE_TICKS = 16;
+
+Behaviour &Behaviour::operator=(Behaviour &&other) noexcept
+{
+    if (this != &other) {
+        if (handle) handle.destroy();
+        handle = std::exchange(other.handle, {});
+    }
+    return *this;
+}
+
+Behaviour::~Behaviour()
+{
+    if (handle) handle.destroy();
+}
+
+size_t Behaviour::resume()
+{
+    if (done()) return 0;
+
+    handle.promise().sleepTicks = 1;
+    handle.resume();
+    return handle.promise().sleepTicks;
+}
+
+// Через сколько тиков other в худшем случае подойдёт на расстояние reach.
+static size_t ticks_until(const NPC &self, const std::shared_ptr<NPC> &other, double reach, int otherSpeed)
+{
+    double gap = self.distance(other) - reach;
+    int closing = std::max(1, otherSpeed);
+    return gap <= 0 ? 1 : std::max<size_t>(1, (size_t)(gap / closing));
+}
+
+Behaviour hunt(std::shared_ptr<NPC> self, const set_t &world)
+{
+    while (self->is_alive()) {
+        self->move(world);
+        co_await sleep_ticks{1};
+    }
+}
+
+Behaviour flee(std::shared_ptr<NPC> self, const set_t &world)
+{
+    while (self->is_alive()) {
+        auto threat = self->nearest(world, Threat);
+        if (threat == nullptr) {
+            co_await sleep_ticks{IDLE_TICKS};
+            continue;
+        }
+
+        double safe = (double)threat->get_range() + threat->get_speed() + self->get_speed();
+        if (self->distance(threat) > safe) {
+            co_await sleep_ticks{ticks_until(*self, threat, safe, MAX_NPC_SPEED)};
+            continue;
+        }
+
+        auto [tx, ty] = threat->position();
+        self->step_away(tx, ty);
+        co_await sleep_ticks{1};
+    }
+}
+
+Behaviour patrol(std::shared_ptr<NPC> self, std::pair<int, int> from, std::pair<int, int> to)
+{
+    auto target = to;
+    while (self->is_alive()) {
+        auto [x, y] = self->position();
+        if (std::abs(target.first - x) + std::abs(target.second - y) <= (int)self->get_speed()) {
+            target = (target == to) ? from : to;
+        }
+        self->step_towards(target.first, target.second);
+        co_await sleep_ticks{1};
+    }
+}
+
+Behaviour wait_then_strike(std::shared_ptr<NPC> self, const set_t &world, size_t maxWait)
+{
+    while (self->is_alive()) {
+        auto prey = self->nearest(world, Prey);
+        if (prey == nullptr) {
+            co_await sleep_ticks{maxWait};
+            continue;
+        }
+
+        double strike = (double)self->get_range() + 2 * self->get_speed();
+        if (self->distance(prey) > strike) {
+            co_await sleep_ticks{std::min(maxWait, ticks_until(*self, prey, strike, MAX_NPC_SPEED))};
+            continue;
+        }
+
+        auto [px, py] = prey->position();
+        self->step_towards(px, py);
+        co_await sleep_ticks{1};
+    }
+}
+
+Behaviour default_behaviour(std::shared_ptr<NPC> self, const set_t &world)
+{
+    // Выпь никого не может убить, поэтому ей выгоднее убегать.
+    if (self->get_type() == VipType) {
+        return flee(std::move(self), world);
+    }
+    return hunt(std::move(self), world);
+}
+
+void BehaviourScheduler::park(size_t slot, size_t tick)
+{
+    agents[slot].wakeTick = tick;
+    wakeups[tick].push_back(slot);
+}
+
+void BehaviourScheduler::spawn(std::shared_ptr<NPC> npc, Behaviour behaviour)
+{
+    size_t id = npc->get_id();
+    size_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        agents[slot] = {std::move(npc), std::move(behaviour), 1};
+    } else {
+        slot = agents.size();
+        agents.push_back({std::move(npc), std::move(behaviour), 1});
+    }
+    slotOf[id] = slot;
+    park(slot, now);
+}
+
+void BehaviourScheduler::wake(NPC &npc)
+{
+    npc.wake();
+
+    auto found = slotOf.find(npc.get_id());
+    if (found == slotOf.end()) return;
+
+    size_t slot = found->second;
+    auto it = wakeups.find(agents[slot].wakeTick);
+    if (agents[slot].wakeTick <= now || it == wakeups.end()) return;
+
+    auto &parked = it->second;
+    parked.erase(std::find(parked.begin(), parked.end(), slot));
+    if (parked.empty()) {
+        wakeups.erase(it);
+    }
+    park(slot, now);
+}
+
+size_t BehaviourScheduler::resumes_at(const NPC &npc) const
+{
+    auto found = slotOf.find(npc.get_id());
+    return found == slotOf.end() ? SIZE_MAX : agents[found->second].wakeTick;
+}
+
+size_t BehaviourScheduler::prepare()
+{
+    ready.clear();
+    auto it = wakeups.find(now);
+    if (it != wakeups.end()) {
+        ready = std::move(it->second);
+        wakeups.erase(it);
+    }
+    return (ready.size() + BEHAVIOUR_BATCH - 1) / BEHAVIOUR_BATCH;
+}
+
+void BehaviourScheduler::resume_batch(size_t batch)
+{
+    size_t from = batch * BEHAVIOUR_BATCH;
+    size_t to = std::min(ready.size(), from + BEHAVIOUR_BATCH);
+
+    for (size_t i = from; i < to; ++i) {
+        Agent &agent = agents[ready[i]];
+        if (!agent.npc->is_alive()) {
+            agent.sleepTicks = 0;
+        } else if (agent.npc->is_sleeping(now)) {
+            // Спящий NPC не ходит: откладываем корутину до пробуждения.
+            agent.sleepTicks = agent.npc->sleeping_until() - now;
+        } else {
+            agent.sleepTicks = agent.behaviour.resume();
+        }
+    }
+
+    // Шаги, которые корутины пачки запросили через step_towards(), считаются
+    // одним векторным проходом по массивам, а не по одному.
+    std::array<int, BEHAVIOUR_BATCH> dx, dy, speed, stepX, stepY;
+    std::array<NPC *, BEHAVIOUR_BATCH> stepping;
+    size_t steps = 0;
+    for (size_t i = from; i < to; ++i) {
+        NPC &npc = *agents[ready[i]].npc;
+        if (npc.pending_step(dx[steps], dy[steps])) {
+            speed[steps] = (int)npc.get_speed();
+            stepping[steps++] = &npc;
+        }
+    }
+
+    fixed_step_batch(dx.data(), dy.data(), speed.data(), stepX.data(), stepY.data(), steps);
+    for (size_t i = 0; i < steps; ++i) {
+        stepping[i]->apply_step(stepX[i], stepY[i]);
+    }
+}
+
+void BehaviourScheduler::commit()
+{
+    for (size_t slot : ready) {
+        Agent &agent = agents[slot];
+        agent.npc->commit_position();
+
+        if (agent.sleepTicks == 0 || agent.behaviour.done()) {
+            slotOf.erase(agent.npc->get_id());
+            agent = {};
+            freeSlots.push_back(slot);
+        } else {
+            park(slot, now + agent.sleepTicks);
+        }
+    }
+
+    ready.clear();
+    ++now;
+}
+
+void BehaviourScheduler::tick(ThreadPool *pool)
+{
+    size_t batches = prepare();
+
+    if (pool != nullptr && batches > 1) {
+        TaskGraph graph;
+        for (size_t b = 0; b < batches; ++b) {
+            graph.add([this, b] { resume_batch(b); });
+        }
+        graph.run(*pool);
+    } else {
+        for (size_t b = 0; b < batches; ++b) {
+            resume_batch(b);
+        }
+    }
+
+    commit();
+}
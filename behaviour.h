@@ -0,0 +1,119 @@
+#pragma once
+#include "npc.h"
+#include "taskGraph.h"
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Поведение NPC записывается корутиной. Между ходами она спит и не тратит
+// процессор, а планировщик будит её на нужном тике.
+struct Behaviour
+{
+    struct promise_type
+    {
+        size_t sleepTicks{1};
+
+        Behaviour get_return_object() { return Behaviour(handle_t::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    using handle_t = std::coroutine_handle<promise_type>;
+
+    Behaviour() = default;
+    explicit Behaviour(handle_t h) : handle(h) {}
+    Behaviour(Behaviour &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+    Behaviour &operator=(Behaviour &&other) noexcept;
+    Behaviour(const Behaviour &) = delete;
+    Behaviour &operator=(const Behaviour &) = delete;
+    ~Behaviour();
+
+    bool done() const { return !handle || handle.done(); }
+
+    // Выполняет один шаг и возвращает, сколько тиков корутина хочет спать.
+    size_t resume();
+
+private:
+    handle_t handle{};
+};
+
+// co_await sleep_ticks{n} - уснуть на n тиков (не меньше одного).
+struct sleep_ticks
+{
+    size_t ticks{1};
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(Behaviour::handle_t h) const noexcept { h.promise().sleepTicks = ticks ? ticks : 1; }
+    void await_resume() const noexcept {}
+};
+
+// Догоняет ближайшего NPC, а если никого нет - бродит (старый NPC::move).
+Behaviour hunt(std::shared_ptr<NPC> self, const set_t &world);
+// Убегает от ближайшей угрозы и спит, пока угроза далеко.
+Behaviour flee(std::shared_ptr<NPC> self, const set_t &world);
+// Ходит туда-обратно между двумя точками.
+Behaviour patrol(std::shared_ptr<NPC> self, std::pair<int, int> from, std::pair<int, int> to);
+// Сидит в засаде, пока добыча не подойдёт, затем бросается на неё.
+Behaviour wait_then_strike(std::shared_ptr<NPC> self, const set_t &world, size_t maxWait);
+
+Behaviour default_behaviour(std::shared_ptr<NPC> self, const set_t &world);
+
+constexpr size_t BEHAVIOUR_BATCH = 1024;
+
+// Планировщик корутин: каждую корутину он будит только на том тике, который
+// она запросила, а готовые к запуску корутины обрабатывает пачками на пуле.
+// Пока идут пачки, NPC видят только позиции прошлого тика, а свои новые
+// пишут в отдельный буфер; commit() применяет их все разом. Результат не
+// зависит ни от числа потоков, ни от порядка пачек, если пока они идут никто
+// не умирает: die() меняет is_alive(), по которому выбираются цели.
+class BehaviourScheduler
+{
+public:
+    void spawn(std::shared_ptr<NPC> npc, Behaviour behaviour);
+
+    // Один тик целиком. С пулом пачки идут параллельно; вызывать не из задачи
+    // этого же пула.
+    void tick(ThreadPool *pool = nullptr);
+
+    // Тик по частям, для встраивания в чужой граф задач: prepare() забирает
+    // готовые корутины и возвращает число пачек, resume_batch() для разных
+    // пачек можно звать параллельно, commit() завершает тик. Шаги, запрошенные
+    // корутинами пачки, resume_batch() считает разом через fixed_step_batch.
+    size_t prepare();
+    void resume_batch(size_t batch);
+    void commit();
+
+    // Досрочно будит уснувшего NPC: его корутина выполнится на ближайшем тике.
+    void wake(NPC &npc);
+
+    // Тик, на котором корутина NPC выполнится в следующий раз (SIZE_MAX, если
+    // корутины нет). Только читает, так что между тиками звать можно из
+    // нескольких потоков.
+    size_t resumes_at(const NPC &npc) const;
+
+    size_t current_tick() const { return now; }
+    size_t active() const { return agents.size() - freeSlots.size(); }
+
+private:
+    struct Agent
+    {
+        std::shared_ptr<NPC> npc;
+        Behaviour behaviour;
+        size_t sleepTicks{1};
+        size_t wakeTick{0};
+    };
+
+    void park(size_t slot, size_t tick);
+
+    size_t now{0};
+    std::vector<size_t> ready;
+    std::vector<Agent> agents;
+    std::vector<size_t> freeSlots;
+    std::map<size_t, std::vector<size_t>> wakeups;
+    std::unordered_map<size_t, size_t> slotOf;
+};
@@ -0,0 +1,239 @@
+#include "checkpoint.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+
+static std::mutex dirtyMutex;
+static std::vector<std::pair<size_t, std::weak_ptr<NPC>>> dirtyNpcs;
+
+void track_dirty(size_t id, std::weak_ptr<NPC> npc)
+{
+    std::lock_guard<std::mutex> lock(dirtyMutex);
+    dirtyNpcs.emplace_back(id, std::move(npc));
+}
+
+static void write_record(std::ostream &os, const NpcRecord &r)
+{
+    os << r.id << " " << r.type << " " << r.x << " " << r.y << " " << r.alive << std::endl;
+}
+
+static bool read_record(std::istream &is, NpcRecord &r)
+{
+    int type{0};
+    if (!(is >> r.id >> type >> r.x >> r.y >> r.alive)) return false;
+    r.type = NpcType(type);
+    return true;
+}
+
+static NpcRecord record_of(NPC &npc)
+{
+    auto [x, y] = npc.position();
+    return {npc.get_id(), npc.get_type(), x, y, npc.is_alive()};
+}
+
+// Снимок + дельты начиная с segment, слитые по id. Дельты хранят полное
+// состояние NPC, поэтому повторное применение одной и той же дельты безопасно.
+static std::map<size_t, NpcRecord> merge_chain(const std::string &basePath, size_t upTo, size_t &nextSegment)
+{
+    std::map<size_t, NpcRecord> state;
+    nextSegment = 1;
+
+    std::ifstream base(basePath);
+    size_t count{0};
+    if (base >> nextSegment >> count) {
+        NpcRecord r;
+        for (size_t i = 0; i < count && read_record(base, r); ++i) {
+            state[r.id] = r;
+        }
+    }
+
+    for (size_t segment = nextSegment; segment < upTo; ++segment) {
+        std::ifstream delta(basePath + "." + std::to_string(segment));
+        if (!delta.is_open()) break;
+
+        size_t tick{0};
+        delta >> tick >> count;
+        NpcRecord r;
+        for (size_t i = 0; i < count && read_record(delta, r); ++i) {
+            if (r.alive) {
+                state[r.id] = r;
+            } else {
+                state.erase(r.id);
+            }
+        }
+        nextSegment = segment + 1;
+    }
+
+    return state;
+}
+
+// Номера дельт base.N, оставшихся на диске от прошлых запусков.
+static std::vector<size_t> existing_segments(const std::string &basePath)
+{
+    namespace fs = std::filesystem;
+
+    fs::path base(basePath);
+    fs::path dir = base.has_parent_path() ? base.parent_path() : fs::path(".");
+    std::string prefix = base.filename().string() + ".";
+
+    std::vector<size_t> segments;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(dir, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= prefix.size() || name.compare(0, prefix.size(), prefix) != 0) continue;
+
+        std::string suffix = name.substr(prefix.size());
+        if (std::all_of(suffix.begin(), suffix.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+            segments.push_back(std::stoull(suffix));
+        }
+    }
+    return segments;
+}
+
+Checkpointer::Checkpointer(std::string basePath) : basePath(std::move(basePath))
+{
+    // Старые дельты остаются читаемыми, пока write_base не заменит снимок,
+    // а новые получают номера после них.
+    auto segments = existing_segments(this->basePath);
+    if (!segments.empty()) {
+        auto [lowest, highest] = std::minmax_element(segments.begin(), segments.end());
+        firstSegment = *lowest;
+        nextSegment = *highest + 1;
+    }
+}
+
+Checkpointer::~Checkpointer()
+{
+    wait_compaction();
+}
+
+std::string Checkpointer::segment_path(size_t segment) const
+{
+    return basePath + "." + std::to_string(segment);
+}
+
+void Checkpointer::write_base(const set_t &npcs)
+{
+    wait_compaction();
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex);
+        dirtyNpcs.clear();
+    }
+
+    std::vector<NpcRecord> records;
+    for (const auto &npc : npcs) {
+        npc->clear_dirty();
+        if (npc->is_alive()) {
+            records.push_back(record_of(*npc));
+        }
+    }
+
+    // Как и при слиянии: новый снимок сначала целиком пишется рядом и только
+    // потом подменяет старый, а старые дельты удаляются последними. При сбое
+    // на любом шаге на диске остаётся целая цепочка.
+    std::lock_guard<std::mutex> lock(chainMutex);
+    std::string tmpPath = basePath + ".tmp";
+    {
+        std::ofstream fs(tmpPath, std::ios::trunc);
+        fs << nextSegment << " " << records.size() << std::endl;
+        for (const auto &r : records) {
+            write_record(fs, r);
+        }
+    }
+
+    std::rename(tmpPath.c_str(), basePath.c_str());
+    for (size_t segment = firstSegment; segment < nextSegment; ++segment) {
+        std::remove(segment_path(segment).c_str());
+    }
+    firstSegment = nextSegment;
+}
+
+size_t Checkpointer::write_delta(size_t tick)
+{
+    std::vector<std::pair<size_t, std::weak_ptr<NPC>>> dirty;
+    {
+        std::lock_guard<std::mutex> lock(dirtyMutex);
+        dirty.swap(dirtyNpcs);
+    }
+
+    std::vector<NpcRecord> records;
+    records.reserve(dirty.size());
+    for (auto &[id, weak] : dirty) {
+        if (auto npc = weak.lock()) {
+            npc->clear_dirty();
+            records.push_back(record_of(*npc));
+        } else {
+            records.push_back({id, Unknown, 0, 0, false});
+        }
+    }
+
+    size_t segment;
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(chainMutex);
+        segment = nextSegment++;
+        pending = nextSegment - firstSegment;
+    }
+
+    std::ofstream fs(segment_path(segment), std::ios::trunc);
+    fs << tick << " " << records.size() << std::endl;
+    for (const auto &r : records) {
+        write_record(fs, r);
+    }
+    fs.close();
+
+    if (pending >= COMPACT_AFTER && !compacting) {
+        wait_compaction();
+        compacting = true;
+        size_t upTo = segment + 1;
+        compactor = std::jthread([this, upTo] {
+            compact(upTo);
+            compacting = false;
+        });
+    }
+
+    return records.size();
+}
+
+void Checkpointer::compact(size_t upTo)
+{
+    size_t merged{0};
+    auto state = merge_chain(basePath, upTo, merged);
+
+    std::string tmpPath = basePath + ".tmp";
+    {
+        std::ofstream fs(tmpPath, std::ios::trunc);
+        fs << merged << " " << state.size() << std::endl;
+        for (const auto &[id, r] : state) {
+            write_record(fs, r);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(chainMutex);
+    std::rename(tmpPath.c_str(), basePath.c_str());
+    for (size_t segment = firstSegment; segment < merged; ++segment) {
+        std::remove(segment_path(segment).c_str());
+    }
+    firstSegment = merged;
+}
+
+void Checkpointer::wait_compaction()
+{
+    if (compactor.joinable()) {
+        compactor.join();
+    }
+}
+
+std::vector<NpcRecord> Checkpointer::restore(const std::string &basePath)
+{
+    size_t nextSegment{0};
+    auto state = merge_chain(basePath, SIZE_MAX, nextSegment);
+
+    std::vector<NpcRecord> result;
+    for (const auto &[id, r] : state) {
+        result.push_back(r);
+    }
+    return result;
+}
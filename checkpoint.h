@@ -0,0 +1,54 @@
+#pragma once
+#include "npc.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t CHECKPOINT_INTERVAL = 5;
+constexpr size_t COMPACT_AFTER = 8;
+
+struct NpcRecord
+{
+    size_t id;
+    NpcType type;
+    int x;
+    int y;
+    bool alive;
+};
+
+// Отмечает NPC изменившимся с прошлой контрольной точки (вызывается из NPC).
+// Список изменившихся NPC один на процесс, поэтому и Checkpointer, который
+// его разбирает, должен быть в процессе один.
+void track_dirty(size_t id, std::weak_ptr<NPC> npc);
+
+// Цепочка контрольных точек: полный снимок в файле base и дельты в файлах
+// base.N, base.N+1, ... В дельту попадают только NPC, которые сдвинулись или
+// погибли с прошлой точки. Когда дельт накапливается COMPACT_AFTER, фоновый
+// поток вливает их в новый снимок. Каждый запуск начинает нумерацию дельт
+// после последней найденной на диске, так что дельты прошлого запуска
+// в новую цепочку не попадают.
+class Checkpointer
+{
+public:
+    explicit Checkpointer(std::string basePath);
+    ~Checkpointer();
+
+    void write_base(const set_t &npcs);
+    size_t write_delta(size_t tick);
+    void wait_compaction();
+
+    static std::vector<NpcRecord> restore(const std::string &basePath);
+
+private:
+    std::string segment_path(size_t segment) const;
+    void compact(size_t upTo);
+
+    std::string basePath;
+    std::mutex chainMutex;
+    size_t firstSegment{1};
+    size_t nextSegment{1};
+    std::atomic<bool> compacting{false};
+    std::jthread compactor;
+};
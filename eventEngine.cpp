@@ -0,0 +1,87 @@
+#include "eventEngine.h"
+#include "activity.h"
+#include "battleManager.h"
+#include <algorithm>
+
+EventEngine::EventEngine(set_t &npcs, BehaviourScheduler &scheduler) : npcs(npcs), scheduler(scheduler) {}
+
+void EventEngine::predict(const std::shared_ptr<NPC> &npc)
+{
+    size_t quiet = NO_CONTACT;
+    for (const auto &other : npcs) {
+        if (other.get() != npc.get() && other->is_alive()) {
+            quiet = std::min(quiet, ticks_to_contact(*npc, *other));
+        }
+    }
+
+    // Врагов нет - событий для этого NPC не будет, пока кто-то не проверит его сам.
+    if (quiet == NO_CONTACT) return;
+
+    size_t version = ++versions[npc->get_id()];
+    queue.push({scheduler.current_tick() + std::max<size_t>(1, quiet), version, npc});
+}
+
+bool EventEngine::stale(const Event &event) const
+{
+    auto it = versions.find(event.npc->get_id());
+    return !event.npc->is_alive() || it == versions.end() || it->second != event.version;
+}
+
+void EventEngine::contact(const std::shared_ptr<NPC> &npc)
+{
+    std::vector<BattleTask> tasks;
+    for (const auto &other : npcs) {
+        if (other.get() != npc.get() && other->is_alive() && npc->is_close(other)) {
+            tasks.push_back({npc, other});
+        }
+    }
+
+    battleTick = scheduler.current_tick();
+    completeBattles(tasks);
+}
+
+size_t EventEngine::run_until(size_t target)
+{
+    if (!started) {
+        for (const auto &npc : npcs) {
+            if (npc->is_alive()) predict(npc);
+        }
+        started = true;
+    }
+
+    size_t handled = 0;
+    while (scheduler.current_tick() < target) {
+        while (!queue.empty() && stale(queue.top())) {
+            queue.pop();
+        }
+
+        // Прогноз консервативен, поэтому до ближайшего события ни одна пара не
+        // может сойтись: двигаем мир без поиска целей и боёв.
+        size_t next = queue.empty() ? target : std::min(target, queue.top().tick);
+        while (scheduler.current_tick() < next) {
+            scheduler.tick();
+        }
+
+        std::vector<std::shared_ptr<NPC>> due;
+        while (!queue.empty() && queue.top().tick <= scheduler.current_tick()) {
+            if (!stale(queue.top())) {
+                due.push_back(queue.top().npc);
+            }
+            queue.pop();
+        }
+
+        for (const auto &npc : due) {
+            if (npc->is_alive()) {
+                contact(npc);
+                ++handled;
+            }
+        }
+
+        // Новые прогнозы считаются только для тех, чьё событие наступило.
+        for (const auto &npc : due) {
+            if (npc->is_alive()) predict(npc);
+        }
+    }
+
+    return handled;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "npc.h"
+#include "behaviour.h"
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+// Событийный режим. Для каждого NPC хранится прогноз самого раннего тика,
+// когда он может сойтись с врагом на дистанцию боя (по известным скоростям).
+// Поиск целей и бои выполняются только на этих тиках, а между ними мир
+// проматывается одним движением, без пауз, боёв и отрисовки. Движение то же,
+// что и в потиковом режиме: NPC в погоне ходят каждый тик, а те, чьё
+// поведение ждёт, ничего не стоят.
+class EventEngine
+{
+public:
+    EventEngine(set_t &npcs, BehaviourScheduler &scheduler);
+
+    // Проматывает мир до тика target. Возвращает число обработанных событий.
+    size_t run_until(size_t target);
+
+    size_t pending() const { return queue.size(); }
+
+private:
+    struct Event
+    {
+        size_t tick;
+        size_t version;
+        std::shared_ptr<NPC> npc;
+
+        bool operator>(const Event &other) const { return tick > other.tick; }
+    };
+
+    void predict(const std::shared_ptr<NPC> &npc);
+    void contact(const std::shared_ptr<NPC> &npc);
+    bool stale(const Event &event) const;
+
+    set_t &npcs;
+    BehaviourScheduler &scheduler;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+    std::unordered_map<size_t, size_t> versions;
+    bool started{false};
+};
@@ -0,0 +1,180 @@
+#include "fightLog.h"
+#include "battleManager.h"
+#include "observerRegistry.h"
+#include <algorithm>
+#include <utility>
+
+bool FightQuery::matches(const FightRecord &r) const
+{
+    return r.tick >= fromTick && r.tick <= toTick &&
+           r.defenderX >= minX && r.defenderX <= maxX &&
+           r.defenderY >= minY && r.defenderY <= maxY &&
+           (attacker == Unknown || r.attackerType == attacker) &&
+           (defender == Unknown || r.defenderType == defender) &&
+           (outcome < 0 || r.outcome == outcome);
+}
+
+bool FightQuery::may_match(const FightBlockHeader &h) const
+{
+    return h.maxTick >= fromTick && h.minTick <= toTick &&
+           h.maxX >= minX && h.minX <= maxX &&
+           h.maxY >= minY && h.minY <= maxY &&
+           (attacker == Unknown || (h.attackerTypes & type_bit(attacker))) &&
+           (defender == Unknown || (h.defenderTypes & type_bit(defender))) &&
+           (outcome < 0 || (outcome <= 1 && (h.outcomes & (1u << outcome))));
+}
+
+// Колонки блока в порядке записи на диск.
+template <typename F>
+static void for_each_column(F &&f)
+{
+    f(&FightRecord::tick);
+    f(&FightRecord::attackerId);
+    f(&FightRecord::defenderId);
+    f(&FightRecord::attackerType);
+    f(&FightRecord::defenderType);
+    f(&FightRecord::outcome);
+    f(&FightRecord::attackerX);
+    f(&FightRecord::attackerY);
+    f(&FightRecord::defenderX);
+    f(&FightRecord::defenderY);
+}
+
+static size_t block_bytes(uint32_t count)
+{
+    size_t bytes = 0;
+    for_each_column([&](auto member) {
+        bytes += sizeof(std::declval<FightRecord>().*member) * count;
+    });
+    return bytes;
+}
+
+FightLogWriter::FightLogWriter(const std::string &fileName)
+{
+    file.open(fileName, std::ios::binary | std::ios::app);
+    pending.reserve(FIGHT_LOG_BLOCK);
+}
+
+FightLogWriter::~FightLogWriter()
+{
+    flush();
+}
+
+void FightLogWriter::append(const FightRecord &record)
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    pending.push_back(record);
+    if (pending.size() >= FIGHT_LOG_BLOCK) {
+        write_block();
+    }
+}
+
+void FightLogWriter::flush()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!pending.empty()) {
+        write_block();
+    }
+    file.flush();
+}
+
+void FightLogWriter::write_block()
+{
+    if (!file.is_open()) {
+        pending.clear();
+        return;
+    }
+
+    FightBlockHeader h{};
+    h.magic = FIGHT_LOG_MAGIC;
+    h.count = pending.size();
+    h.minTick = std::numeric_limits<uint32_t>::max();
+    h.minX = h.minY = std::numeric_limits<int16_t>::max();
+    h.maxX = h.maxY = std::numeric_limits<int16_t>::min();
+
+    for (const auto &r : pending) {
+        h.minTick = std::min(h.minTick, r.tick);
+        h.maxTick = std::max(h.maxTick, r.tick);
+        h.minX = std::min(h.minX, r.defenderX);
+        h.maxX = std::max(h.maxX, r.defenderX);
+        h.minY = std::min(h.minY, r.defenderY);
+        h.maxY = std::max(h.maxY, r.defenderY);
+        h.attackerTypes |= type_bit(NpcType(r.attackerType));
+        h.defenderTypes |= type_bit(NpcType(r.defenderType));
+        h.outcomes |= 1u << r.outcome;
+    }
+
+    file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    for_each_column([&](auto member) {
+        for (const auto &r : pending) {
+            file.write(reinterpret_cast<const char *>(&(r.*member)), sizeof(r.*member));
+        }
+    });
+
+    pending.clear();
+}
+
+FightQueryResult query_fight_log(const std::string &fileName, const FightQuery &query)
+{
+    FightQueryResult result;
+    std::ifstream file(fileName, std::ios::binary);
+
+    FightBlockHeader h;
+    std::vector<FightRecord> block;
+    while (file.read(reinterpret_cast<char *>(&h), sizeof(h))) {
+        if (h.magic != FIGHT_LOG_MAGIC) break;
+        ++result.blocksTotal;
+
+        // Блок, который по заголовку не может подойти, просто перепрыгиваем.
+        if (!query.may_match(h)) {
+            file.seekg(block_bytes(h.count), std::ios::cur);
+            continue;
+        }
+
+        ++result.blocksRead;
+        block.assign(h.count, FightRecord{});
+        for_each_column([&](auto member) {
+            for (auto &r : block) {
+                file.read(reinterpret_cast<char *>(&(r.*member)), sizeof(r.*member));
+            }
+        });
+
+        for (const auto &r : block) {
+            if (query.matches(r)) {
+                result.records.push_back(r);
+            }
+        }
+    }
+
+    return result;
+}
+
+void render_text(std::ostream &os, const FightRecord &r)
+{
+    os << "{ x:" << r.attackerX << ", y:" << r.attackerY << "} "
+       << (r.outcome ? " убивает " : " не смог убить ")
+       << "{ x:" << r.defenderX << ", y:" << r.defenderY << "} " << std::endl;
+}
+
+void FightLogObserver::on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win)
+{
+    on_fight_at(attacker, defender, win, {attacker->position(), defender->position()});
+}
+
+void FightLogObserver::on_fight_at(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win,
+                                   const FightPositions &where)
+{
+    auto [ax, ay] = where.attacker;
+    auto [dx, dy] = where.defender;
+
+    writer.append({
+        (uint32_t)battleTick.load(std::memory_order_relaxed),
+        (uint32_t)attacker->get_id(),
+        (uint32_t)defender->get_id(),
+        (uint8_t)attacker->get_type(),
+        (uint8_t)defender->get_type(),
+        (uint8_t)(win ? 1 : 0),
+        (int16_t)ax, (int16_t)ay,
+        (int16_t)dx, (int16_t)dy
+    });
+}
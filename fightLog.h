@@ -0,0 +1,103 @@
+#pragma once
+#include "npc.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+constexpr size_t FIGHT_LOG_BLOCK = 1024;
+constexpr uint32_t FIGHT_LOG_MAGIC = 0x46474C42; // "FGLB"
+
+// Одна запись журнала боёв фиксированного размера. Позиция боя - место,
+// где стоял защитник.
+struct FightRecord
+{
+    uint32_t tick;
+    uint32_t attackerId;
+    uint32_t defenderId;
+    uint8_t attackerType;
+    uint8_t defenderType;
+    uint8_t outcome;
+    int16_t attackerX;
+    int16_t attackerY;
+    int16_t defenderX;
+    int16_t defenderY;
+};
+
+// Заголовок блока: сколько в нём записей и минимальные/максимальные значения
+// полей, по которым запрос решает, нужно ли вообще читать блок.
+struct FightBlockHeader
+{
+    uint32_t magic;
+    uint32_t count;
+    uint32_t minTick;
+    uint32_t maxTick;
+    int16_t minX;
+    int16_t maxX;
+    int16_t minY;
+    int16_t maxY;
+    uint8_t attackerTypes;
+    uint8_t defenderTypes;
+    uint8_t outcomes;
+    uint8_t reserved;
+};
+
+struct FightQuery
+{
+    uint32_t fromTick{0};
+    uint32_t toTick{std::numeric_limits<uint32_t>::max()};
+    int minX{std::numeric_limits<int16_t>::min()};
+    int maxX{std::numeric_limits<int16_t>::max()};
+    int minY{std::numeric_limits<int16_t>::min()};
+    int maxY{std::numeric_limits<int16_t>::max()};
+    NpcType attacker{Unknown};
+    NpcType defender{Unknown};
+    // -1 - любой исход, иначе 0 или 1; другие значения не совпадут ни с чем.
+    int outcome{-1};
+
+    bool matches(const FightRecord &r) const;
+    bool may_match(const FightBlockHeader &h) const;
+};
+
+// Пишет записи блоками по FIGHT_LOG_BLOCK, каждое поле - отдельной колонкой.
+class FightLogWriter
+{
+public:
+    explicit FightLogWriter(const std::string &fileName);
+    ~FightLogWriter();
+
+    void append(const FightRecord &record);
+    void flush();
+
+private:
+    void write_block();
+
+    std::ofstream file;
+    std::vector<FightRecord> pending;
+    std::mutex mtx;
+};
+
+struct FightQueryResult
+{
+    std::vector<FightRecord> records;
+    size_t blocksTotal{0};
+    size_t blocksRead{0};
+};
+
+FightQueryResult query_fight_log(const std::string &fileName, const FightQuery &query);
+
+// Человекочитаемый вид записи - как строки прежнего log.txt.
+void render_text(std::ostream &os, const FightRecord &record);
+
+class FightLogObserver : public IFightObserver
+{
+public:
+    explicit FightLogObserver(const std::string &fileName) : writer(fileName) {}
+
+    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) override;
+    void on_fight_at(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win,
+                     const FightPositions &where) override;
+    void flush() { writer.flush(); }
+
+private:
+    FightLogWriter writer;
+};
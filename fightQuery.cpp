@@ -0,0 +1,95 @@
+#include "fightLog.h"
+#include <cstdlib>
+
+// Запросы к журналу боёв, например "убийства Медведей в квадрате между тиками":
+//   fightQuery fights.log --attacker bear --region 0 0 200 200 --ticks 5 20
+
+void usage()
+{
+    std::cout << "fightQuery <file> [--attacker T] [--defender T] [--ticks A B]\n"
+              << "           [--region X0 Y0 X1 Y1] [--outcome 0|1] [--count]\n"
+              << "T: bear | vip | vihuhol" << std::endl;
+}
+
+// Unknown в запросе означает "любой тип", поэтому опечатку в имени нельзя
+// молча превращать в него.
+NpcType parse_type(const std::string &name)
+{
+    if (name == "bear") return BearType;
+    if (name == "vip") return VipType;
+    if (name == "vihuhol") return VihuholType;
+
+    usage();
+    std::exit(1);
+}
+
+int parse_outcome(const std::string &value)
+{
+    if (value == "0") return 0;
+    if (value == "1") return 1;
+
+    usage();
+    std::exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::string fileName = argv[1];
+    FightQuery query;
+    bool countOnly = false;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto need = [&](int n) {
+            if (i + n >= argc) {
+                usage();
+                std::exit(1);
+            }
+        };
+
+        if (arg == "--attacker") {
+            need(1);
+            query.attacker = parse_type(argv[++i]);
+        } else if (arg == "--defender") {
+            need(1);
+            query.defender = parse_type(argv[++i]);
+        } else if (arg == "--ticks") {
+            need(2);
+            query.fromTick = std::atoi(argv[++i]);
+            query.toTick = std::atoi(argv[++i]);
+        } else if (arg == "--region") {
+            need(4);
+            query.minX = std::atoi(argv[++i]);
+            query.minY = std::atoi(argv[++i]);
+            query.maxX = std::atoi(argv[++i]);
+            query.maxY = std::atoi(argv[++i]);
+        } else if (arg == "--outcome") {
+            need(1);
+            query.outcome = parse_outcome(argv[++i]);
+        } else if (arg == "--count") {
+            countOnly = true;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    auto result = query_fight_log(fileName, query);
+
+    if (!countOnly) {
+        for (const auto &r : result.records) {
+            std::cout << "[" << r.tick << "] ";
+            render_text(std::cout, r);
+        }
+    }
+
+    std::cout << "Найдено боёв: " << result.records.size()
+              << " (прочитано блоков " << result.blocksRead << " из " << result.blocksTotal << ")" << std::endl;
+
+    return 0;
+}
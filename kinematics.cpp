@@ -0,0 +1,26 @@
+#include "kinematics.h"
+
+void fixed_step_batch(const int *dx, const int *dy, const int *speed, int *outX, int *outY, size_t n)
+{
+    // Деление здесь в double: все числа меньше 2^53, поэтому результат после
+    // отбрасывания дробной части тот же, что у целочисленного деления в
+    // fixed_step, но double делится векторно, а int64_t - нет.
+    for (size_t i = 0; i < n; ++i) {
+        int ax = dx[i] < 0 ? -dx[i] : dx[i];
+        int ay = dy[i] < 0 ? -dy[i] : dy[i];
+        bool steep = ay > ax;
+        int lo = steep ? ax : ay;
+        int hi = steep ? ay : ax;
+        double safeHi = hi | (hi == 0);
+
+        // (lo * ATAN_STEPS + hi / 2) / hi, как в direction_index.
+        int a = ATAN_TABLE[(int)((2.0 * ATAN_STEPS * lo + hi) / (2 * safeHi))];
+        a = steep ? DIRECTIONS / 4 - a : a;
+        a = dx[i] < 0 ? DIRECTIONS / 2 - a : a;
+        a = dy[i] < 0 ? DIRECTIONS - a : a;
+        a &= DIRECTIONS - 1;
+
+        outX[i] = (int)((double)COS_TABLE[a] * speed[i] / FIXED_ONE);
+        outY[i] = (int)((double)SIN_TABLE[a] * speed[i] / FIXED_ONE);
+    }
+}
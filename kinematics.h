@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Движение в целых числах с фиксированной точкой. Таблицы направлений
+// строятся на этапе компиляции, поэтому результат шага побитово одинаков
+// на любом компиляторе и любой машине.
+
+constexpr int FIXED_SHIFT = 16;
+constexpr int32_t FIXED_ONE = 1 << FIXED_SHIFT;
+
+// Число направлений на полный круг и точность таблицы арктангенса.
+constexpr int DIRECTIONS = 4096;
+constexpr int ATAN_STEPS = 4096;
+
+constexpr double KIN_PI = 3.14159265358979323846;
+
+constexpr double constexpr_sqrt(double v)
+{
+    if (v <= 0) return 0;
+    double r = v > 1 ? v : 1;
+    for (int i = 0; i < 64; ++i) {
+        r = 0.5 * (r + v / r);
+    }
+    return r;
+}
+
+constexpr double constexpr_sin(double a)
+{
+    while (a > KIN_PI) a -= 2 * KIN_PI;
+    while (a < -KIN_PI) a += 2 * KIN_PI;
+
+    double term = a;
+    double sum = a;
+    for (int n = 1; n < 16; ++n) {
+        term *= -a * a / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+// atan(t) для t из [0, 1]: сначала t уменьшается формулой половинного угла.
+constexpr double constexpr_atan(double t)
+{
+    double h = t / (1 + constexpr_sqrt(1 + t * t));
+    double term = h;
+    double sum = h;
+    for (int n = 1; n < 24; ++n) {
+        term *= -h * h;
+        sum += term / (2 * n + 1);
+    }
+    return 2 * sum;
+}
+
+constexpr int32_t to_fixed(double v)
+{
+    return (int32_t)(v * FIXED_ONE + (v >= 0 ? 0.5 : -0.5));
+}
+
+constexpr std::array<int32_t, DIRECTIONS> make_sin_table()
+{
+    std::array<int32_t, DIRECTIONS> table{};
+    for (int i = 0; i < DIRECTIONS; ++i) {
+        table[i] = to_fixed(constexpr_sin(2 * KIN_PI * i / DIRECTIONS));
+    }
+    return table;
+}
+
+constexpr std::array<int32_t, DIRECTIONS> make_cos_table()
+{
+    std::array<int32_t, DIRECTIONS> table{};
+    for (int i = 0; i < DIRECTIONS; ++i) {
+        table[i] = to_fixed(constexpr_sin(2 * KIN_PI * i / DIRECTIONS + KIN_PI / 2));
+    }
+    return table;
+}
+
+// Индекс направления по отношению катетов (меньший / больший) - первый октант.
+constexpr std::array<int32_t, ATAN_STEPS + 1> make_atan_table()
+{
+    std::array<int32_t, ATAN_STEPS + 1> table{};
+    for (int i = 0; i <= ATAN_STEPS; ++i) {
+        double angle = constexpr_atan((double)i / ATAN_STEPS);
+        table[i] = (int32_t)(angle * DIRECTIONS / (2 * KIN_PI) + 0.5);
+    }
+    return table;
+}
+
+inline constexpr auto SIN_TABLE = make_sin_table();
+inline constexpr auto COS_TABLE = make_cos_table();
+inline constexpr auto ATAN_TABLE = make_atan_table();
+
+static_assert(COS_TABLE[0] == FIXED_ONE && SIN_TABLE[0] == 0);
+static_assert(SIN_TABLE[DIRECTIONS / 4] == FIXED_ONE && COS_TABLE[DIRECTIONS / 4] == 0);
+static_assert(ATAN_TABLE[ATAN_STEPS] == DIRECTIONS / 8);
+
+// Аналог atan2(dy, dx), но в индексах таблицы направлений [0, DIRECTIONS).
+constexpr int direction_index(int dx, int dy)
+{
+    int64_t ax = dx < 0 ? -(int64_t)dx : dx;
+    int64_t ay = dy < 0 ? -(int64_t)dy : dy;
+    if (ax == 0 && ay == 0) return 0;
+
+    bool steep = ay > ax;
+    int64_t lo = steep ? ax : ay;
+    int64_t hi = steep ? ay : ax;
+    int a = ATAN_TABLE[(lo * ATAN_STEPS + hi / 2) / hi];
+
+    if (steep) a = DIRECTIONS / 4 - a;
+    if (dx < 0) a = DIRECTIONS / 2 - a;
+    if (dy < 0) a = DIRECTIONS - a;
+    return a & (DIRECTIONS - 1);
+}
+
+// Смещение длиной speed в сторону (dx, dy). Дробная часть отбрасывается к нулю,
+// как при прежнем (int)(cos(angle) * speed).
+constexpr std::pair<int, int> fixed_step(int dx, int dy, int speed)
+{
+    int dir = direction_index(dx, dy);
+    return {
+        (int)((int64_t)COS_TABLE[dir] * speed / FIXED_ONE),
+        (int)((int64_t)SIN_TABLE[dir] * speed / FIXED_ONE)
+    };
+}
+
+static_assert(fixed_step(10, 0, 5) == std::pair<int, int>{5, 0});
+static_assert(fixed_step(0, -10, 50) == std::pair<int, int>{0, -50});
+static_assert(fixed_step(-7, 0, 5) == std::pair<int, int>{-5, 0});
+
+// Тот же fixed_step сразу для n NPC, по отдельным массивам (SoA). Ветвлений на
+// элемент нет, и цикл векторизуется; результат побитово равен fixed_step.
+// dx и dy не должны быть INT_MIN.
+void fixed_step_batch(const int *dx, const int *dy, const int *speed, int *outX, int *outY, size_t n);
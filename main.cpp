@@ -3,6 +3,15 @@
 #include "vip.h"
 #include "vihuhol.h"
 #include "battleManager.h"
+#include "observerRegistry.h"
+#include "populationStats.h"
+#include "behaviour.h"
+#include "tickExecutor.h"
+#include "eventEngine.h"
+#include "checkpoint.h"
+#include "fightLog.h"
+#include "statsServer.h"
+#include <array>
 #include <atomic>
 #include <ctime>
 #include <thread>
@@ -10,6 +19,10 @@
 using namespace std::chrono_literals;
 std::atomic<bool> stopFlag = false;
 
+constexpr bool PIN_THREADS = false;
+const std::string CHECKPOINT_FILE = "checkpoint.txt";
+const std::string STATS_SOCKET = "npc.sock";
+
 class TextObserver : public IFightObserver
 {
 public:
@@ -29,26 +42,8 @@ public:
     }
 };
 
-class FileObserver : public IFightObserver
-{
-private:
-    std::ofstream logFile;
-
-public:
-    FileObserver(const std::string& fileName) {
-        logFile.open(fileName, std::ios_base::app);
-    }
-
-    void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win)
-    {
-        if (win && logFile.is_open()) {
-            logFile << *attacker << " убивает " << *defender << std::endl;
-        }
-    }
-};
-
 std::shared_ptr<TextObserver> textObs = std::make_shared<TextObserver>();
-std::shared_ptr<FileObserver> fileObs = std::make_shared<FileObserver>("log.txt");
+std::shared_ptr<FightLogObserver> fightLogObs = std::make_shared<FightLogObserver>("fights.log");
 
 std::shared_ptr<NPC> factory(std::istream &is)
 {
@@ -59,24 +54,19 @@ std::shared_ptr<NPC> factory(std::istream &is)
         switch (type)
         {
             case BearType:
-                result = std::make_shared<Bear>(is);
+                result = spawn_npc<Bear>(is);
                 break;
             case VipType:
-                result = std::make_shared<Vip>(is);
+                result = spawn_npc<Vip>(is);
                 break;
             case VihuholType:
-                result = std::make_shared<Vihuhol>(is);
+                result = spawn_npc<Vihuhol>(is);
                 break;
             default:
                 break;
         }
     }
 
-    if (result) {
-        result->subscribe(textObs);
-        result->subscribe(fileObs);
-    }
-
     return result;
 }
 
@@ -86,23 +76,18 @@ std::shared_ptr<NPC> factory(NpcType type, int x, int y)
 
     switch (type) {
         case BearType:
-            result = std::make_shared<Bear>(x, y);
+            result = spawn_npc<Bear>(x, y);
             break;
         case VipType:
-            result = std::make_shared<Vip>(x, y);
+            result = spawn_npc<Vip>(x, y);
             break;
         case VihuholType:
-            result = std::make_shared<Vihuhol>(x, y);
+            result = spawn_npc<Vihuhol>(x, y);
             break;
         default:
             break;
     }
 
-    if (result) {
-        result->subscribe(textObs);
-        result->subscribe(fileObs);
-    }
-
     return result;
 }
 
@@ -138,113 +123,117 @@ set_t load(const std::string &fileName)
 
 // NEW ПОТОКИ
 
-void moveThread(set_t &npcs)
+void printField(const set_t &npcs)
 {
-    while (!stopFlag) {
-        {
-            std::shared_lock<std::shared_mutex> lock(npcMutex);
-
-            for (const auto &attacker : npcs) {
-                if (attacker->is_alive()) {
+    const int grid{20};
+    const int stepX{(int)MAP_SIZE / grid};
+    const int stepY{(int)MAP_SIZE / grid};
+    std::array<char, grid * grid> fields;
 
-                    attacker->move(npcs);
+    fields.fill(' ');
 
-                    for (const auto &defender : npcs) {
-                        if (attacker.get() != defender.get() && defender->is_alive() && attacker->is_close(defender)) {
-                            std::lock_guard<std::mutex> tasks_lock(battleTasksMutex);
-                            battleTasks.push({attacker, defender});
-                        }
-                    }
+    for (const std::shared_ptr<NPC> &npc : npcs)
+    {
+        if (npc->is_alive())
+        {
+            const auto [x, y] = npc->position();
+            int i = x / stepX;
+            int j = y / stepY;
+
+            if (i >= 0 && i < grid && j >= 0 && j < grid) {
+                char c = '_';
+                switch (npc->get_type())
+                {
+                    case BearType:
+                        c = 'B';
+                        break;
+                    case VipType:
+                        c = 'V';
+                        break;
+                    case VihuholType:
+                        c = 'X';
+                        break;
+                    default:
+                        break;
                 }
+                fields[i + grid * j] = c;
             }
         }
-        
-        std::this_thread::sleep_for(1000ms);
+    }
+
+    std::lock_guard<std::mutex> lock_cout(coutMutex);
+
+    std::cout << "\n         Игровое поле        \n";
+    PopulationSnapshot population = populationStats.snapshot();
+    std::cout << "B: " << population.alive[BearType]
+              << "  V: " << population.alive[VipType]
+              << "  X: " << population.alive[VihuholType] << std::endl;
+    for (int j = 0; j < grid; ++j) {
+        for (int i = 0; i < grid; ++i) {
+            char c = fields[i + j * grid];
+            std::cout << "[" << c << "]";
+        }
+        std::cout << std::endl;
     }
 }
 
-void battleThread()
+// Тики идут конвейером на пуле потоков: бои и отрисовка прошлого тика
+// перекрываются с движением и поиском целей следующего.
+void simulationThread(set_t &npcs, BehaviourScheduler &scheduler, Checkpointer &checkpointer)
 {
-    while (!stopFlag) {
-        BattleTask currentTask;
-        bool taskFound = false;
+    ThreadPool pool(std::thread::hardware_concurrency(), PIN_THREADS);
+    TickExecutor executor(npcs, scheduler, pool, [&npcs] { printField(npcs); });
 
-        {
-            std::lock_guard<std::mutex> tasks_lock(battleTasksMutex);
+    while (!stopFlag) {
+        if (!simulationControl.paused) {
+            std::shared_lock<std::shared_mutex> lock(npcMutex);
+            executor.run_tick();
 
-            if (!battleTasks.empty()) {
-                currentTask = battleTasks.front();
-                battleTasks.pop();
-                taskFound = true;
+            if (scheduler.current_tick() % CHECKPOINT_INTERVAL == 0) {
+                checkpointer.write_delta(scheduler.current_tick());
             }
         }
 
-        if (taskFound) {
-            completeBattle(currentTask);
-        } else {
-            std::this_thread::sleep_for(10ms);
+        if (simulationControl.snapshotRequested.exchange(false)) {
+            std::shared_lock<std::shared_mutex> lock(npcMutex);
+            checkpointer.write_base(npcs);
         }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(simulationControl.tickPeriodMs));
     }
+
+    std::shared_lock<std::shared_mutex> lock(npcMutex);
+    executor.finish();
 }
 
-void printThread(set_t &npcs)
+// Событийный режим: те же GAME_LENGTH тиков, но без пауз между ними и с
+// поиском целей только на предсказанных тиках сближения.
+void eventSimulation(set_t &npcs, BehaviourScheduler &scheduler)
 {
-    const int grid{20};
-    const int stepX{(int)MAP_SIZE / grid};
-    const int stepY{(int)MAP_SIZE / grid};
-    std::array<char, grid * grid> fields;
-
-    while (!stopFlag) {
-        std::shared_lock<std::shared_mutex> lock_npc(npcMutex);
-
-        fields.fill(' ');
-
-        for (const std::shared_ptr<NPC> &npc : npcs)
-        {
-            if (npc->is_alive())
-            {
-                const auto [x, y] = npc->position();
-                int i = x / stepX;
-                int j = y / stepY;
-
-                if (i >= 0 && i < grid && j >= 0 && j < grid) {
-                    char c = '_';
-                    switch (npc->get_type())
-                    {
-                        case BearType:
-                            c = 'B';
-                            break;
-                        case VipType:
-                            c = 'V';
-                            break;
-                        case VihuholType:
-                            c = 'X';
-                            break;
-                        default:
-                            break;
-                    }
-                    fields[i + grid * j] = c;
-                }
-            }
-        }
+    std::shared_lock<std::shared_mutex> lock(npcMutex);
+    EventEngine engine(npcs, scheduler);
 
-        lock_npc.unlock();
+    size_t events = engine.run_until(GAME_LENGTH);
+    printField(npcs);
 
-        {
-            std::lock_guard<std::mutex> lock_cout(coutMutex);
+    std::lock_guard<std::mutex> lock_cout(coutMutex);
+    std::cout << "\nОбработано событий: " << events << std::endl;
+}
 
-            std::cout << "\n         Игровое поле        \n";
-            for (int j = 0; j < grid; ++j) {
-                for (int i = 0; i < grid; ++i) {
-                    char c = fields[i + j * grid];
-                    std::cout << "[" << c << "]";
-                }
-                std::cout << std::endl;
-            }
-            
-        }
-        
-        std::this_thread::sleep_for(1000ms);
+void printPopulation()
+{
+    const std::pair<NpcType, const char *> names[] = {
+        {BearType, "Медведи"},
+        {VipType, "Выпи"},
+        {VihuholType, "Выхухоли"}
+    };
+
+    PopulationSnapshot population = populationStats.snapshot();
+
+    std::cout << "Живых всего: " << population.aliveTotal << std::endl;
+    for (const auto &[type, name] : names) {
+        std::cout << name << ": живых " << population.alive[type]
+                  << ", убийств " << population.kills[type] << std::endl;
     }
 }
 
@@ -256,55 +245,89 @@ std::ostream &operator<<(std::ostream &os, const set_t &array)
     return os;
 }
 
-int main()
+int main(int argc, char **argv)
 {
+    bool eventMode = false;
+    bool resume = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        eventMode = eventMode || arg == "--events";
+        resume = resume || arg == "--resume";
+    }
+
     std::srand(static_cast<unsigned int>(std::time(nullptr)));
     set_t npcs;
-    auto observer = std::make_shared<TextObserver>();
+    BehaviourScheduler scheduler;
+    Checkpointer checkpointer(CHECKPOINT_FILE);
+
+    fightObservers.subscribe(textObs);
+    fightObservers.subscribe(fightLogObs, AllTypes, WinEvent);
 
     {
         std::lock_guard<std::shared_mutex> lock(npcMutex);
-        std::cout << "Генерация NPC..." << std::endl;
-        for (size_t i = 0; i < NPC_COUNT; ++i) {
-            int type = rand() % 3 + 1;
+        if (resume) {
+            std::cout << "Восстановление из " << CHECKPOINT_FILE << "..." << std::endl;
+            for (const auto &r : Checkpointer::restore(CHECKPOINT_FILE)) {
+                if (auto npc = factory(r.type, r.x, r.y)) {
+                    npcs.insert(npc);
+                }
+            }
+        } else {
+            std::cout << "Генерация NPC..." << std::endl;
+            for (size_t i = 0; i < NPC_COUNT; ++i) {
+                int type = rand() % 3 + 1;
 
-            int x = std::rand() % (MAP_SIZE + 1);
-            int y = std::rand() % (MAP_SIZE + 1);
+                int x = std::rand() % (MAP_SIZE + 1);
+                int y = std::rand() % (MAP_SIZE + 1);
 
-            auto npc = factory(NpcType(type), x, y);
-            if (npc) {
-                npcs.insert(npc);
+                if (auto npc = factory(NpcType(type), x, y)) {
+                    npcs.insert(npc);
+                }
             }
         }
+
+        for (const auto &npc : npcs) {
+            scheduler.spawn(npc, default_behaviour(npc, npcs));
+        }
+
+        // Восстановленные NPC получают новые id, поэтому цепочка начинается заново.
+        checkpointer.write_base(npcs);
     }
 
     std::cout << "Начало симуляции..." << std::endl;
-    std::thread moveThr(moveThread, std::ref(npcs));
-    std::thread battleThr(battleThread);
-    std::thread printThr(printThread, std::ref(npcs));
+    if (eventMode) {
+        eventSimulation(npcs, scheduler);
+    } else {
+        StatsServer statsServer(STATS_SOCKET);
+        if (!statsServer.start()) {
+            std::cout << "Не удалось открыть " << STATS_SOCKET << ", статистика недоступна" << std::endl;
+        }
 
-    std::this_thread::sleep_for(std::chrono::seconds(GAME_LENGTH));
+        std::thread simulationThr(simulationThread, std::ref(npcs), std::ref(scheduler), std::ref(checkpointer));
 
-    stopFlag = true;
+        std::this_thread::sleep_for(std::chrono::seconds(GAME_LENGTH));
 
-    if (moveThr.joinable()) {
-        moveThr.join();
-    }
-    if (battleThr.joinable()) {
-        battleThr.join();
+        stopFlag = true;
+
+        if (simulationThr.joinable()) {
+            simulationThr.join();
+        }
     }
-    if (printThr.joinable()) {
-        printThr.join();
+
+    {
+        std::shared_lock<std::shared_mutex> lock(npcMutex);
+        checkpointer.write_delta(scheduler.current_tick());
     }
+    fightLogObs->flush();
 
-    std::cout << "\n\nСимуляция завершена. Список выживших:\n" << std::endl;
+    std::cout << "\n\nСимуляция завершена.\n" << std::endl;
+    printPopulation();
+    std::cout << "\nСписок выживших:\n" << std::endl;
 
-    std::shared_lock<std::shared_mutex> lock(npcMutex);
-    for (const auto &npc : npcs) {
-        if (npc->is_alive()) {
-            std::cout << std::endl;
-            npc->print();
-        }
+    // Выживших берём из индекса статистики, а не обходом npcs под npcMutex.
+    for (const auto &npc : populationStats.survivors()) {
+        std::cout << std::endl;
+        npc->print();
     }
 
     std::cout << std::endl;
@@ -2,17 +2,47 @@
 #include "bear.h"
 #include "vip.h"
 #include "vihuhol.h"
+#include "observerRegistry.h"
+#include "populationStats.h"
+#include "kinematics.h"
+#include "checkpoint.h"
 #include <algorithm>
 
 
 std::mutex coutMutex;
 std::shared_mutex npcMutex;
 
-NPC::NPC(NpcType t, int _x, int _y) : type(t), x(_x), y(_y) {}
-NPC::NPC(NpcType t, std::istream &is) : type(t)
+static std::atomic<size_t> nextNpcId{1};
+
+NPC::NPC(NpcType t, int _x, int _y) : id(nextNpcId++), type(t), x(_x), y(_y), nextX(_x), nextY(_y) {}
+NPC::NPC(NpcType t, std::istream &is) : id(nextNpcId++), type(t)
 {
     is >> x;
     is >> y;
+    nextX = x;
+    nextY = y;
+}
+
+NPC::~NPC()
+{
+    if (alive) {
+        populationStats.on_death(*this);
+    }
+}
+
+void NPC::die()
+{
+    if (alive.exchange(false)) {
+        populationStats.on_death(*this);
+        mark_dirty();
+    }
+}
+
+void NPC::mark_dirty()
+{
+    if (!dirty.exchange(true)) {
+        track_dirty(id, weak_from_this());
+    }
 }
 
 void NPC::save(std::ostream &os)
@@ -30,37 +60,83 @@ void NPC::move(const set_t &others)
 {
     if (!is_alive()) return;
 
-    std::shared_ptr<NPC> nearest = nullptr;
+    auto target = nearest(others);
+
+    if (target != nullptr) {
+        auto [tx, ty] = target->position();
+        step_towards(tx, ty);
+    } else {
+        wander();
+    }
+}
+
+std::shared_ptr<NPC> NPC::nearest(const set_t &others, Relation relation) const
+{
+    std::shared_ptr<NPC> result = nullptr;
     double minDist = 100000;
 
     for (const auto& other: others) {
-        if (other->is_alive() && (other.get() != this)) {
-            double dist = distance(other);
-            if (nearest == nullptr || dist < minDist) {
-                nearest = other;
-                minDist = dist;
-            }
+        if (!other->is_alive() || other.get() == this) continue;
+        if (relation == Threat && !can_kill(other->type, type)) continue;
+        if (relation == Prey && !can_kill(type, other->type)) continue;
+
+        double dist = distance(other);
+        if (result == nullptr || dist < minDist) {
+            result = other;
+            minDist = dist;
         }
     }
 
-    int newX = x;
-    int newY = y;
+    return result;
+}
+
+void NPC::step_towards(int targetX, int targetY)
+{
+    settle_step();
 
-    if (nearest != nullptr) {
-        double dx = (double)nearest->x - x;
-        double dy = (double)nearest->y - y;
-        double angle = std::atan2(dy, dx);
+    stepDx = targetX - nextX;
+    stepDy = targetY - nextY;
+    stepPending = true;
+    mark_dirty();
+}
 
-        newX += (int)(std::cos(angle) * speed);
-        newY += (int)(std::sin(angle) * speed);
-    } else {
+void NPC::step_away(int fromX, int fromY)
+{
+    settle_step();
+    step_towards(2 * nextX - fromX, 2 * nextY - fromY);
+}
 
-        newX = rand() % (2 * speed + 1) - speed;
-        newY = rand() % (2 * (speed - abs(newX)) + 1) - (speed - abs(newX));
-    }
+bool NPC::pending_step(int &dx, int &dy) const
+{
+    dx = stepDx;
+    dy = stepDy;
+    return stepPending;
+}
+
+void NPC::apply_step(int dx, int dy)
+{
+    nextX = std::clamp(nextX + dx, 0, (int)MAP_SIZE);
+    nextY = std::clamp(nextY + dy, 0, (int)MAP_SIZE);
+    stepPending = false;
+}
+
+void NPC::settle_step()
+{
+    if (!stepPending) return;
+
+    auto [dx, dy] = fixed_step(stepDx, stepDy, speed);
+    apply_step(dx, dy);
+}
+
+void NPC::wander()
+{
+    settle_step();
+    int dx = rand() % (2 * speed + 1) - speed;
+    int dy = rand() % (2 * (speed - abs(dx)) + 1) - (speed - abs(dx));
 
-    x = std::clamp(newX, 0, (int)MAP_SIZE);
-    y = std::clamp(newY, 0, (int)MAP_SIZE);
+    nextX = std::clamp(nextX + dx, 0, (int)MAP_SIZE);
+    nextY = std::clamp(nextY + dy, 0, (int)MAP_SIZE);
+    mark_dirty();
 }
 
 double NPC::distance(std::shared_ptr<NPC> other) const
@@ -73,16 +149,17 @@ bool NPC::is_close(const std::shared_ptr<NPC> other) const
     return distance(other) < killRange;
 }
 
-void NPC::subscribe(std::shared_ptr<IFightObserver> observer)
+// Без подписчиков не собираем ни позиции, ни shared_ptr на себя.
+void NPC::fight_notify(const std::shared_ptr<NPC> defender, bool win)
 {
-    observers.push_back(observer);
+    if (!fightObservers.has_listeners(type, win)) return;
+    fightObservers.notify(shared_from_this(), defender, win, {position(), defender->position()});
 }
 
-void NPC::fight_notify(const std::shared_ptr<NPC> defender, bool win)
+void NPC::fight_notify(const std::shared_ptr<NPC> defender, bool win, const FightPositions &where)
 {
-    std::lock_guard<std::mutex> lock(coutMutex);
-    for (auto &o : observers)
-        o->on_fight(shared_from_this(), defender, win);
+    if (!fightObservers.has_listeners(type, win)) return;
+    fightObservers.notify(shared_from_this(), defender, win, where);
 }
 
 std::ostream &operator<<(std::ostream &os, NPC &npc)
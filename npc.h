@@ -10,6 +10,7 @@
 #include <math.h>
 #include <mutex>
 #include <shared_mutex>
+#include <atomic>
 
 constexpr size_t MAP_SIZE = 400;
 constexpr size_t NPC_COUNT = 50;
@@ -30,38 +31,87 @@ enum NpcType
     VihuholType = 3
 };
 
+// Кто кого может убить - то же, что зашито в перегрузках fight().
+constexpr bool can_kill(NpcType attacker, NpcType defender)
+{
+    return (attacker == BearType && (defender == VipType || defender == VihuholType)) ||
+           (attacker == VihuholType && defender == BearType);
+}
+
+enum Relation
+{
+    AnyNpc = 0,
+    Threat = 1,
+    Prey = 2
+};
+
 extern std::mutex coutMutex;
 extern std::shared_mutex npcMutex;
 
+// Позиции участников боя на момент, когда бой был обнаружен.
+struct FightPositions {
+    std::pair<int, int> attacker;
+    std::pair<int, int> defender;
+};
+
 struct IFightObserver {
     virtual void on_fight(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win) = 0;
+    // К моменту рассылки NPC уже могли сдвинуться; кому важны координаты
+    // боя, берёт их отсюда.
+    virtual void on_fight_at(const std::shared_ptr<NPC> attacker, const std::shared_ptr<NPC> defender, bool win,
+                             const FightPositions &)
+    {
+        on_fight(attacker, defender, win);
+    }
 };
 
 struct NPC : public std::enable_shared_from_this<NPC>
 {
 protected:
+    size_t id;
     NpcType type;
+    // x, y - позиция на конец прошлого тика, её читают все. Ход NPC пишет
+    // в nextX, nextY, а commit_position() делает её видимой остальным.
     int x;
     int y;
+    int nextX;
+    int nextY;
+    // Шаг, запрошенный step_towards(): смещение до цели от nextX, nextY.
+    // Посчитать его может планировщик - для всей пачки разом.
+    int stepDx{0};
+    int stepDy{0};
+    bool stepPending{false};
     int speed{0};
     int killRange{0};
-    bool alive{true};
-    std::vector<std::shared_ptr<IFightObserver>> observers;
+    std::atomic<bool> alive{true};
+    std::atomic<size_t> sleepUntil{0};
+    std::atomic<bool> dirty{false};
 
 public:
     NPC(NpcType t, int _x, int _y);
     NPC(NpcType t, std::istream &is);
+    virtual ~NPC();
 
+    size_t get_id() const { return id; }
     NpcType get_type() const { return type; }
     std::pair<int, int> position() const { return {x, y}; }
     size_t get_speed() const { return speed; }
     size_t get_range() const { return killRange; }
     bool is_alive() const { return alive; }
 
-    void die() { alive = false; }
+    void die();
+
+    bool is_sleeping(size_t tick) const { return sleepUntil.load(std::memory_order_relaxed) > tick; }
+    size_t sleeping_until() const { return sleepUntil.load(std::memory_order_relaxed); }
+    void sleep_until(size_t tick) { sleepUntil.store(tick, std::memory_order_relaxed); }
+    void wake() { sleepUntil.store(0, std::memory_order_relaxed); }
+
+    // Изменился с прошлой контрольной точки (сдвинулся или погиб).
+    void mark_dirty();
+    void clear_dirty() { dirty.store(false, std::memory_order_relaxed); }
 
-    void subscribe(std::shared_ptr<IFightObserver> observer);
     void fight_notify(const std::shared_ptr<NPC> defender, bool win);
+    void fight_notify(const std::shared_ptr<NPC> defender, bool win, const FightPositions &where);
     virtual bool is_close(std::shared_ptr<NPC> other) const;
 
     virtual bool accept(std::shared_ptr<NPC> visitor) = 0;
@@ -78,6 +128,19 @@ public:
 
     void move(const set_t &others);
 
+    std::shared_ptr<NPC> nearest(const set_t &others, Relation relation = AnyNpc) const;
+    void step_towards(int targetX, int targetY);
+    void step_away(int fromX, int fromY);
+    void wander();
+
+    // Отложенный шаг: pending_step() отдаёт смещение до цели, apply_step()
+    // применяет посчитанный по нему шаг. settle_step() считает его сам, если
+    // этого ещё никто не сделал.
+    bool pending_step(int &dx, int &dy) const;
+    void apply_step(int dx, int dy);
+    void settle_step();
+    void commit_position() { settle_step(); x = nextX; y = nextY; }
+
     int roll_dice();
 
     double distance(std::shared_ptr<NPC> other) const;
@@ -0,0 +1,64 @@
+#include "observerRegistry.h"
+#include <algorithm>
+
+ObserverRegistry fightObservers;
+
+void ObserverRegistry::count(const Subscription &s, int delta)
+{
+    for (int t = BearType; t <= VihuholType; ++t) {
+        if (!(s.typeMask & type_bit(NpcType(t)))) continue;
+        if (s.events & WinEvent) listeners[slot(NpcType(t), true)] += delta;
+        if (s.events & LoseEvent) listeners[slot(NpcType(t), false)] += delta;
+    }
+}
+
+ObserverRegistry::id_t ObserverRegistry::subscribe(std::shared_ptr<IFightObserver> observer, unsigned typeMask, unsigned events)
+{
+    std::lock_guard<std::shared_mutex> lock(mtx);
+    subscriptions.push_back({nextId, std::move(observer), typeMask, events});
+    count(subscriptions.back(), 1);
+    return nextId++;
+}
+
+void ObserverRegistry::unsubscribe(id_t id)
+{
+    std::lock_guard<std::shared_mutex> lock(mtx);
+    auto it = std::find_if(subscriptions.begin(), subscriptions.end(),
+                           [id](const Subscription &s) { return s.id == id; });
+    if (it != subscriptions.end()) {
+        count(*it, -1);
+        subscriptions.erase(it);
+    }
+}
+
+void ObserverRegistry::clear()
+{
+    std::lock_guard<std::shared_mutex> lock(mtx);
+    subscriptions.clear();
+    for (auto &l : listeners) {
+        l = 0;
+    }
+}
+
+bool ObserverRegistry::has_listeners(NpcType attacker, bool win) const
+{
+    return listeners[slot(attacker, win)].load(std::memory_order_relaxed) != 0;
+}
+
+void ObserverRegistry::notify(const std::shared_ptr<NPC> &attacker, const std::shared_ptr<NPC> &defender, bool win,
+                              const FightPositions &where)
+{
+    // Без подписчиков рассылка ничего не стоит: ни мьютексов, ни обхода списка.
+    if (!has_listeners(attacker->get_type(), win)) return;
+
+    const unsigned event = win ? WinEvent : LoseEvent;
+    const unsigned bit = type_bit(attacker->get_type());
+
+    std::lock_guard<std::mutex> lock_cout(coutMutex);
+    std::shared_lock<std::shared_mutex> lock(mtx);
+    for (auto &s : subscriptions) {
+        if ((s.typeMask & bit) && (s.events & event)) {
+            s.observer->on_fight_at(attacker, defender, win, where);
+        }
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "npc.h"
+#include <array>
+#include <atomic>
+#include <vector>
+
+enum FightEvent
+{
+    WinEvent = 1,
+    LoseEvent = 2,
+    AnyEvent = WinEvent | LoseEvent
+};
+
+constexpr unsigned type_bit(NpcType t) { return 1u << t; }
+constexpr unsigned AllTypes = type_bit(BearType) | type_bit(VipType) | type_bit(VihuholType);
+
+// Общий реестр наблюдателей: NPC больше не хранят подписчиков у себя.
+// Подписка фильтруется по типу атакующего и по исходу боя.
+struct ObserverRegistry
+{
+    using id_t = size_t;
+
+    id_t subscribe(std::shared_ptr<IFightObserver> observer, unsigned typeMask = AllTypes, unsigned events = AnyEvent);
+    void unsubscribe(id_t id);
+    void clear();
+
+    bool has_listeners(NpcType attacker, bool win) const;
+    void notify(const std::shared_ptr<NPC> &attacker, const std::shared_ptr<NPC> &defender, bool win,
+                const FightPositions &where);
+
+private:
+    struct Subscription {
+        id_t id;
+        std::shared_ptr<IFightObserver> observer;
+        unsigned typeMask;
+        unsigned events;
+    };
+
+    static size_t slot(NpcType t, bool win) { return t * 2 + (win ? 1 : 0); }
+    void count(const Subscription &s, int delta);
+
+    mutable std::shared_mutex mtx;
+    std::vector<Subscription> subscriptions;
+    std::array<std::atomic<size_t>, (VihuholType + 1) * 2> listeners{};
+    id_t nextId{1};
+};
+
+extern ObserverRegistry fightObservers;
@@ -0,0 +1,69 @@
+#include "populationStats.h"
+
+PopulationStats populationStats;
+
+void PopulationStats::on_spawn(const std::shared_ptr<NPC> &npc)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    if (!npc->is_alive() || !indexOf.emplace(npc->get_id(), aliveNpcs.size()).second) return;
+    aliveNpcs.push_back({npc->get_id(), npc});
+
+    ++counts.alive[npc->get_type()];
+    ++counts.aliveTotal;
+    published.store(counts);
+}
+
+void PopulationStats::on_death(NPC &npc)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    auto it = indexOf.find(npc.get_id());
+    if (it == indexOf.end()) return;
+
+    // Удаление перестановкой с последним элементом - O(1).
+    size_t pos = it->second;
+    aliveNpcs[pos] = std::move(aliveNpcs.back());
+    indexOf[aliveNpcs[pos].id] = pos;
+    aliveNpcs.pop_back();
+    indexOf.erase(npc.get_id());
+
+    --counts.alive[npc.get_type()];
+    --counts.aliveTotal;
+    published.store(counts);
+}
+
+void PopulationStats::on_kill(NpcType killer)
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    ++counts.kills[killer];
+    published.store(counts);
+}
+
+bool PopulationStats::is_alive(size_t id) const
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    return indexOf.count(id) != 0;
+}
+
+std::vector<size_t> PopulationStats::alive_ids() const
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    std::vector<size_t> ids;
+    ids.reserve(aliveNpcs.size());
+    for (const auto &entry : aliveNpcs) {
+        ids.push_back(entry.id);
+    }
+    return ids;
+}
+
+std::vector<std::shared_ptr<NPC>> PopulationStats::survivors() const
+{
+    std::lock_guard<std::mutex> lock(indexMutex);
+    std::vector<std::shared_ptr<NPC>> result;
+    result.reserve(aliveNpcs.size());
+    for (const auto &entry : aliveNpcs) {
+        if (auto npc = entry.npc.lock()) {
+            result.push_back(std::move(npc));
+        }
+    }
+    return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "npc.h"
+#include "seqlock.h"
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Согласованный снимок счётчиков: сумма alive по типам всегда равна aliveTotal.
+struct PopulationSnapshot
+{
+    std::array<size_t, VihuholType + 1> alive{};
+    std::array<size_t, VihuholType + 1> kills{};
+    size_t aliveTotal{0};
+};
+
+// Живая статистика популяции. Обновляется за O(1) при рождении и смерти NPC,
+// поэтому читать её можно без npcMutex и без обхода всего set_t.
+struct PopulationStats
+{
+    // Регистрирует уже построенный NPC; создавайте NPC через spawn_npc.
+    void on_spawn(const std::shared_ptr<NPC> &npc);
+    void on_death(NPC &npc);
+    void on_kill(NpcType killer);
+
+    PopulationSnapshot snapshot() const { return published.load(); }
+    size_t alive(NpcType type) const { return snapshot().alive[type]; }
+    size_t alive_total() const { return snapshot().aliveTotal; }
+    size_t kills(NpcType type) const { return snapshot().kills[type]; }
+
+    bool is_alive(size_t id) const;
+    std::vector<size_t> alive_ids() const;
+    // Живые NPC по индексу. Индекс ими не владеет: NPC, которых уже никто
+    // не держит, в ответ не попадают.
+    std::vector<std::shared_ptr<NPC>> survivors() const;
+
+private:
+    struct Entry
+    {
+        size_t id;
+        std::weak_ptr<NPC> npc;
+    };
+
+    mutable std::mutex indexMutex;
+    PopulationSnapshot counts;
+    SeqLock<PopulationSnapshot> published;
+    std::vector<Entry> aliveNpcs;
+    std::unordered_map<size_t, size_t> indexOf;
+};
+
+extern PopulationStats populationStats;
+
+// Создаёт NPC и учитывает его в статистике, когда объект построен целиком:
+// из конструктора NPC читатели статистики увидели бы недостроенный объект.
+template <typename T, typename... Args>
+std::shared_ptr<T> spawn_npc(Args &&...args)
+{
+    auto npc = std::make_shared<T>(std::forward<Args>(args)...);
+    populationStats.on_spawn(npc);
+    return npc;
+}
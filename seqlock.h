@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Публикация небольшой структуры целиком: читатель либо видит одну
+// согласованную версию, либо повторяет чтение. Писатель должен быть один
+// (или писатели сериализуются снаружи), читатели ничего не блокируют.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    void store(const T &value)
+    {
+        uint64_t buf[WORDS]{};
+        std::memcpy(buf, &value, sizeof(T));
+
+        uint64_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i) {
+            words[i].store(buf[i], std::memory_order_relaxed);
+        }
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    T load() const
+    {
+        uint64_t buf[WORDS];
+        for (;;) {
+            uint64_t before = seq.load(std::memory_order_acquire);
+            if (before & 1) continue;
+
+            for (size_t i = 0; i < WORDS; ++i) {
+                buf[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (seq.load(std::memory_order_relaxed) == before) break;
+        }
+
+        T value;
+        std::memcpy(&value, buf, sizeof(T));
+        return value;
+    }
+
+private:
+    std::atomic<uint64_t> seq{0};
+    std::array<std::atomic<uint64_t>, WORDS> words{};
+};
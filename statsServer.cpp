@@ -0,0 +1,155 @@
+#include "statsServer.h"
+#include "populationStats.h"
+#include "tickExecutor.h"
+#include <sstream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+SimulationControl simulationControl;
+
+static void write_stats(std::ostream &os)
+{
+    PopulationSnapshot population = populationStats.snapshot();
+
+    os << "tick=" << phaseTimings.tick << "\n"
+       << "paused=" << simulationControl.paused << "\n"
+       << "tick_period_ms=" << simulationControl.tickPeriodMs << "\n"
+       << "alive_total=" << population.aliveTotal << "\n"
+       << "alive_bear=" << population.alive[BearType] << "\n"
+       << "alive_vip=" << population.alive[VipType] << "\n"
+       << "alive_vihuhol=" << population.alive[VihuholType] << "\n"
+       << "kills_bear=" << population.kills[BearType] << "\n"
+       << "kills_vip=" << population.kills[VipType] << "\n"
+       << "kills_vihuhol=" << population.kills[VihuholType] << "\n"
+       << "queue_depth=" << phaseTimings.queueDepth << "\n"
+       << "move_us=" << phaseTimings.moveUs << "\n"
+       << "detect_us=" << phaseTimings.detectUs << "\n"
+       << "battle_us=" << phaseTimings.battleUs << "\n"
+       << "render_us=" << phaseTimings.renderUs << "\n";
+}
+
+static void write_density(std::ostream &os)
+{
+    DensitySnapshot density = densityMap.load();
+
+    os << "tick=" << density.tick << "\n";
+    for (int j = 0; j < DENSITY_GRID; ++j) {
+        for (int i = 0; i < DENSITY_GRID; ++i) {
+            os << (i ? " " : "") << density.cells[i + DENSITY_GRID * j];
+        }
+        os << "\n";
+    }
+}
+
+std::string handle_command(const std::string &command)
+{
+    std::istringstream is(command);
+    std::string name;
+    is >> name;
+
+    std::ostringstream os;
+    if (name.empty() || name == "stats") {
+        write_stats(os);
+    } else if (name == "density") {
+        write_density(os);
+    } else if (name == "pause") {
+        simulationControl.paused = true;
+        os << "ok\n";
+    } else if (name == "resume") {
+        simulationControl.paused = false;
+        os << "ok\n";
+    } else if (name == "rate") {
+        int ms{0};
+        if (is >> ms && ms > 0) {
+            simulationControl.tickPeriodMs = ms;
+            os << "ok\n";
+        } else {
+            os << "error: rate <ms>\n";
+        }
+    } else if (name == "snapshot") {
+        simulationControl.snapshotRequested = true;
+        os << "ok\n";
+    } else {
+        os << "error: unknown command " << name << "\n";
+    }
+    return os.str();
+}
+
+StatsServer::StatsServer(std::string socketPath) : socketPath(std::move(socketPath)) {}
+
+StatsServer::~StatsServer()
+{
+    stop();
+}
+
+bool StatsServer::start()
+{
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) return false;
+    socketPath.copy(addr.sun_path, socketPath.size());
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+
+    ::unlink(socketPath.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(listenFd, 8) < 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+
+    thread = std::jthread([this](std::stop_token stop) { serve(stop); });
+    return true;
+}
+
+void StatsServer::stop()
+{
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+        listenFd = -1;
+    }
+}
+
+void StatsServer::serve(std::stop_token stop)
+{
+    while (!stop.stop_requested()) {
+        pollfd pfd{listenFd, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+
+        int client = ::accept(listenFd, nullptr, nullptr);
+        if (client < 0) continue;
+
+        // Молчащий или не читающий клиент не должен держать сервер.
+        timeval timeout{1, 0};
+        ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::string command;
+        char buf[256];
+        ssize_t n;
+        while (command.find('\n') == std::string::npos && (n = ::read(client, buf, sizeof(buf))) > 0) {
+            command.append(buf, n);
+        }
+
+        // MSG_NOSIGNAL: если клиент ушёл, не дождавшись ответа, send вернёт
+        // EPIPE, а не убьёт весь процесс сигналом SIGPIPE. Такой клиент
+        // просто отбрасывается.
+        std::string reply = handle_command(command.substr(0, command.find('\n')));
+        for (size_t sent = 0; sent < reply.size();) {
+            ssize_t n = ::send(client, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+        ::close(client);
+    }
+}
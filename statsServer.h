@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Управление симуляцией снаружи. Поток симуляции только читает эти флаги.
+struct SimulationControl
+{
+    std::atomic<bool> paused{false};
+    std::atomic<int> tickPeriodMs{1000};
+    std::atomic<bool> snapshotRequested{false};
+};
+
+extern SimulationControl simulationControl;
+
+// Ответ на одну команду: stats, density, pause, resume, rate <мс>, snapshot.
+// Всё читается из атомарно опубликованного состояния, npcMutex не берётся.
+std::string handle_command(const std::string &command);
+
+// Локальная точка доступа на Unix-сокете: одна команда на соединение,
+// ответ текстом, после чего соединение закрывается.
+//   echo stats | nc -U npc.sock
+class StatsServer
+{
+public:
+    explicit StatsServer(std::string socketPath);
+    ~StatsServer();
+
+    bool start();
+    void stop();
+
+private:
+    void serve(std::stop_token stop);
+
+    std::string socketPath;
+    int listenFd{-1};
+    std::jthread thread;
+};
@@ -0,0 +1,151 @@
+#include "taskGraph.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+static thread_local size_t currentWorker = SIZE_MAX;
+static thread_local const ThreadPool *currentPool = nullptr;
+
+ThreadPool::ThreadPool(size_t threads, bool pinThreads)
+{
+    threads = std::max<size_t>(1, threads);
+    for (size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+
+    for (size_t i = 0; i < threads; ++i) {
+        this->threads.emplace_back([this, i](std::stop_token stop) { worker(i, stop); });
+
+#ifdef __linux__
+        if (pinThreads) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(i % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+            pthread_setaffinity_np(this->threads.back().native_handle(), sizeof(cpus), &cpus);
+        }
+#else
+        (void)pinThreads;
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    for (auto &t : threads) {
+        t.request_stop();
+    }
+    wakeUp.notify_all();
+    threads.clear();
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+    // Задачи, порождённые внутри пула, кладём в свою очередь - так данные
+    // остаются в кэше того же ядра.
+    size_t index = (currentPool == this) ? currentWorker : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mtx);
+        queues[index]->jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        ++pending;
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::pop_local(size_t index, std::function<void()> &job)
+{
+    std::lock_guard<std::mutex> lock(queues[index]->mtx);
+    if (queues[index]->jobs.empty()) return false;
+    job = std::move(queues[index]->jobs.back());
+    queues[index]->jobs.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t index, std::function<void()> &job)
+{
+    for (size_t i = 1; i < queues.size(); ++i) {
+        Queue &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mtx);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker(size_t index, std::stop_token stop)
+{
+    currentWorker = index;
+    currentPool = this;
+
+    while (!stop.stop_requested()) {
+        std::function<void()> job;
+        if (pop_local(index, job) || steal(index, job)) {
+            --pending;
+            job();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, stop, [this] { return pending > 0; });
+    }
+}
+
+TaskGraph::task_id TaskGraph::add(std::function<void()> fn, const std::vector<task_id> &deps)
+{
+    task_id id = nodes.size();
+    nodes.emplace_back();
+    nodes.back().fn = std::move(fn);
+    nodes.back().dependencies = deps.size();
+    for (task_id dep : deps) {
+        nodes[dep].successors.push_back(id);
+    }
+    return id;
+}
+
+void TaskGraph::launch(ThreadPool &pool, task_id id)
+{
+    pool.submit([this, &pool, id] {
+        Node &node = nodes[id];
+        node.fn();
+
+        for (task_id next : node.successors) {
+            if (--nodes[next].remaining == 0) {
+                launch(pool, next);
+            }
+        }
+
+        // Счётчик уменьшаем под мьютексом, иначе run() может вернуться и
+        // уничтожить граф, пока этот поток ещё трогает doneMutex.
+        std::lock_guard<std::mutex> lock(doneMutex);
+        if (--unfinished == 0) {
+            done.notify_all();
+        }
+    });
+}
+
+void TaskGraph::run(ThreadPool &pool)
+{
+    if (nodes.empty()) return;
+
+    unfinished = nodes.size();
+    for (auto &node : nodes) {
+        node.remaining = node.dependencies;
+    }
+
+    for (task_id id = 0; id < nodes.size(); ++id) {
+        if (nodes[id].dependencies == 0) {
+            launch(pool, id);
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [this] { return unfinished == 0; });
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с кражей работы: у каждого потока своя очередь, из которой он
+// берёт задачи с конца, а простаивающие потоки забирают задачи с начала
+// чужих очередей.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads = std::thread::hardware_concurrency(), bool pinThreads = false);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> job);
+    size_t size() const { return queues.size(); }
+
+private:
+    struct Queue
+    {
+        std::mutex mtx;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    void worker(size_t index, std::stop_token stop);
+    bool pop_local(size_t index, std::function<void()> &job);
+    bool steal(size_t index, std::function<void()> &job);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::jthread> threads;
+    std::atomic<size_t> nextQueue{0};
+    std::atomic<size_t> pending{0};
+    std::mutex sleepMutex;
+    std::condition_variable_any wakeUp;
+};
+
+// Граф задач одного прогона: задача запускается, когда выполнены все её
+// зависимости. run() блокирует вызывающий поток до окончания всех задач.
+class TaskGraph
+{
+public:
+    using task_id = size_t;
+
+    task_id add(std::function<void()> fn, const std::vector<task_id> &deps = {});
+    void run(ThreadPool &pool);
+
+private:
+    struct Node
+    {
+        std::function<void()> fn;
+        std::vector<task_id> successors;
+        size_t dependencies{0};
+        std::atomic<size_t> remaining{0};
+    };
+
+    void launch(ThreadPool &pool, task_id id);
+
+    std::deque<Node> nodes;
+    std::atomic<size_t> unfinished{0};
+    std::mutex doneMutex;
+    std::condition_variable done;
+};
@@ -7,6 +7,30 @@
 #include "bear.h"
 #include "vip.h"
 #include "vihuhol.h"
+#include "observerRegistry.h"
+#include "populationStats.h"
+#include "battleManager.h"
+#include "behaviour.h"
+#include "kinematics.h"
+#include "activity.h"
+#include "taskGraph.h"
+#include "tickExecutor.h"
+#include "eventEngine.h"
+#include "checkpoint.h"
+#include "fightLog.h"
+#include "statsServer.h"
+#include <sstream>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <chrono>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 // --- 1. Mock Observer ---
 // Вспомогательный класс для тестирования, который записывает результат боя, 
@@ -27,16 +51,21 @@ public:
 // Базовый класс для тестов, который содержит вспомогательные функции для создания NPC.
 class FightTest : public ::testing::Test {
 protected:
-    // Вспомогательные функции для создания NPC через std::make_shared
-    // Это важно, так как NPC наследуют std::enable_shared_from_this.
+    // Реестр наблюдателей глобальный, поэтому после каждого теста его чистим.
+    void TearDown() override {
+        fightObservers.clear();
+    }
+
+    // Вспомогательные функции для создания NPC через spawn_npc (std::make_shared
+    // плюс учёт в статистике). Это важно, так как NPC наследуют std::enable_shared_from_this.
     std::shared_ptr<Bear> createBear(int x = 0, int y = 0) {
-        return std::make_shared<Bear>(x, y);
+        return spawn_npc<Bear>(x, y);
     }
     std::shared_ptr<Vip> createVip(int x = 0, int y = 0) {
-        return std::make_shared<Vip>(x, y);
+        return spawn_npc<Vip>(x, y);
     }
     std::shared_ptr<Vihuhol> createVihuhol(int x = 0, int y = 0) {
-        return std::make_shared<Vihuhol>(x, y);
+        return spawn_npc<Vihuhol>(x, y);
     }
 };
 
@@ -53,7 +82,7 @@ TEST_F(FightTest, BearVsVip_BearWins) {
     auto bear = createBear();
     auto vip = createVip();
     auto obs = std::make_shared<MockObserver>();
-    bear->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(BearType));
 
     // Медведь атакует Выпь. Bear::fight(Vip) -> true
     bool result = vip->accept(bear);
@@ -66,7 +95,7 @@ TEST_F(FightTest, BearVsVihuhol_BearWins) {
     auto bear = createBear();
     auto vihuhol = createVihuhol();
     auto obs = std::make_shared<MockObserver>();
-    bear->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(BearType));
     
     // Медведь атакует Выхухоль. Bear::fight(Vihuhol) -> true
     bool result = vihuhol->accept(bear);
@@ -79,7 +108,7 @@ TEST_F(FightTest, BearVsBear_Draw) {
     auto bear1 = createBear();
     auto bear2 = createBear();
     auto obs = std::make_shared<MockObserver>();
-    bear1->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(BearType));
     
     // Медведь атакует Медведя. Bear::fight(Bear) -> false
     bool result = bear2->accept(bear1);
@@ -93,7 +122,7 @@ TEST_F(FightTest, VipVsBear_Draw) {
     auto vip = createVip();
     auto bear = createBear();
     auto obs = std::make_shared<MockObserver>();
-    vip->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(VipType));
 
     // Выпь атакует Медведя. Vip::fight(Bear) -> false
     bool result = bear->accept(vip);
@@ -106,7 +135,7 @@ TEST_F(FightTest, VipVsVihuhol_Draw) {
     auto vip = createVip();
     auto vihuhol = createVihuhol();
     auto obs = std::make_shared<MockObserver>();
-    vip->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(VipType));
 
     // Выпь атакует Выхухоль. Vip::fight(Vihuhol) -> false
     bool result = vihuhol->accept(vip);
@@ -119,7 +148,7 @@ TEST_F(FightTest, VipVsVip_Draw) {
     auto vip1 = createVip();
     auto vip2 = createVip();
     auto obs = std::make_shared<MockObserver>();
-    vip1->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(VipType));
 
     // Выпь атакует Выпь. Vip::fight(Vip) -> false
     bool result = vip2->accept(vip1);
@@ -133,7 +162,7 @@ TEST_F(FightTest, VihuholVsBear_VihuholWins) {
     auto vihuhol = createVihuhol();
     auto bear = createBear();
     auto obs = std::make_shared<MockObserver>();
-    vihuhol->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(VihuholType));
 
     // Выхухоль атакует Медведя. Vihuhol::fight(Bear) -> true
     bool result = bear->accept(vihuhol);
@@ -146,7 +175,7 @@ TEST_F(FightTest, VihuholVsVip_Draw) {
     auto vihuhol = createVihuhol();
     auto vip = createVip();
     auto obs = std::make_shared<MockObserver>();
-    vihuhol->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(VihuholType));
 
     // Выхухоль атакует Выпь. Vihuhol::fight(Vip) -> false
     bool result = vip->accept(vihuhol);
@@ -159,11 +188,840 @@ TEST_F(FightTest, VihuholVsVihuhol_Draw) {
     auto vihuhol1 = createVihuhol();
     auto vihuhol2 = createVihuhol();
     auto obs = std::make_shared<MockObserver>();
-    vihuhol1->subscribe(obs);
+    fightObservers.subscribe(obs, type_bit(VihuholType));
 
     // Выхухоль атакует Выхухоль. Vihuhol::fight(Vihuhol) -> false
     bool result = vihuhol2->accept(vihuhol1);
 
     ASSERT_FALSE(result) << "Выхухоли должны разойтись миром.";
     ASSERT_FALSE(obs->lastWin);
-}
\ No newline at end of file
+}
+
+// =====================================================================
+// ТЕСТЫ РЕЕСТРА НАБЛЮДАТЕЛЕЙ
+// =====================================================================
+
+TEST_F(FightTest, Registry_FiltersByAttackerType) {
+    auto bear = createBear();
+    auto vip = createVip();
+    auto obs = std::make_shared<MockObserver>();
+    fightObservers.subscribe(obs, type_bit(VihuholType));
+
+    vip->accept(bear);
+
+    ASSERT_EQ(obs->callCount, 0) << "Подписка только на Выхухолей не должна ловить бои Медведя.";
+}
+
+TEST_F(FightTest, Registry_FiltersByEvent) {
+    auto bear = createBear();
+    auto vip = createVip();
+    auto bear2 = createBear();
+    auto obs = std::make_shared<MockObserver>();
+    fightObservers.subscribe(obs, AllTypes, WinEvent);
+
+    bear2->accept(bear);
+    ASSERT_EQ(obs->callCount, 0) << "Ничья не должна доходить до подписчика только на победы.";
+
+    vip->accept(bear);
+    ASSERT_EQ(obs->callCount, 1);
+    ASSERT_TRUE(obs->lastWin);
+}
+
+TEST_F(FightTest, Registry_Unsubscribe) {
+    auto bear = createBear();
+    auto vip = createVip();
+    auto obs = std::make_shared<MockObserver>();
+    auto id = fightObservers.subscribe(obs);
+
+    ASSERT_TRUE(fightObservers.has_listeners(BearType, true));
+    fightObservers.unsubscribe(id);
+    ASSERT_FALSE(fightObservers.has_listeners(BearType, true));
+
+    vip->accept(bear);
+    ASSERT_EQ(obs->callCount, 0);
+}
+
+// =====================================================================
+// ТЕСТЫ СТАТИСТИКИ ПОПУЛЯЦИИ
+// Статистика глобальная, поэтому проверяем приращения, а не абсолютные значения.
+// =====================================================================
+
+TEST_F(FightTest, Stats_SpawnAndDeath) {
+    size_t bearsBefore = populationStats.alive(BearType);
+    auto bear = createBear();
+
+    ASSERT_EQ(populationStats.alive(BearType), bearsBefore + 1);
+    ASSERT_TRUE(populationStats.is_alive(bear->get_id()));
+
+    bear->die();
+    bear->die();
+
+    ASSERT_EQ(populationStats.alive(BearType), bearsBefore) << "Повторная смерть не должна учитываться.";
+    ASSERT_FALSE(populationStats.is_alive(bear->get_id()));
+}
+
+TEST_F(FightTest, Stats_DestroyedAliveNpcIsRemoved) {
+    size_t vipsBefore = populationStats.alive(VipType);
+    {
+        auto vip = createVip();
+        ASSERT_EQ(populationStats.alive(VipType), vipsBefore + 1);
+    }
+    ASSERT_EQ(populationStats.alive(VipType), vipsBefore);
+}
+
+TEST_F(FightTest, Stats_SnapshotAndSurvivorIndex) {
+    auto bear = createBear();
+    auto vip = createVip();
+    vip->die();
+
+    PopulationSnapshot population = populationStats.snapshot();
+    ASSERT_EQ(population.alive[BearType] + population.alive[VipType] + population.alive[VihuholType],
+              population.aliveTotal);
+
+    auto survivors = populationStats.survivors();
+    ASSERT_NE(std::find(survivors.begin(), survivors.end(), bear), survivors.end());
+    ASSERT_EQ(std::find(survivors.begin(), survivors.end(), vip), survivors.end());
+}
+
+TEST_F(FightTest, Stats_OnlyFinishedNpcsAreRegistered) {
+    size_t bearsBefore = populationStats.alive(BearType);
+
+    // Конструктор сам в статистику не пишет - регистрирует spawn_npc.
+    auto bare = std::make_shared<Bear>(0, 0);
+    ASSERT_EQ(populationStats.alive(BearType), bearsBefore);
+    bare->die();
+    ASSERT_EQ(populationStats.alive(BearType), bearsBefore);
+
+    auto bear = createBear();
+    ASSERT_EQ(populationStats.alive(BearType), bearsBefore + 1);
+    auto survivors = populationStats.survivors();
+    ASSERT_NE(std::find(survivors.begin(), survivors.end(), bear), survivors.end());
+}
+
+TEST_F(FightTest, Stats_KillIsCounted) {
+    auto bear = createBear();
+    auto vip = createVip();
+    size_t killsBefore = populationStats.kills(BearType);
+    auto mock = std::make_shared<MockObserver>();
+    fightObservers.subscribe(mock);
+
+    // Кубики случайны, поэтому повторяем бой, пока Выпь не погибнет.
+    int battles = 0;
+    while (vip->is_alive()) {
+        completeBattles({{bear, vip}});
+        ++battles;
+    }
+
+    ASSERT_EQ(populationStats.kills(BearType), killsBefore + 1);
+    ASSERT_EQ(mock->callCount, battles) << "Каждый бой - ровно одно уведомление.";
+    ASSERT_TRUE(mock->lastWin);
+}
+
+// =====================================================================
+// ТЕСТЫ КОРУТИН ПОВЕДЕНИЯ
+// =====================================================================
+
+TEST_F(FightTest, Behaviour_HuntApproachesTarget) {
+    auto bear = createBear(0, 0);
+    auto vip = createVip(100, 0);
+    set_t world{bear, vip};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(bear, hunt(bear, world));
+    scheduler.tick();
+    scheduler.tick();
+
+    ASSERT_EQ(bear->position(), std::make_pair(10, 0)) << "Медведь делает по шагу за тик.";
+}
+
+TEST_F(FightTest, Behaviour_FleeSleepsWhileThreatIsFar) {
+    auto bear = createBear(0, 0);
+    auto vip = createVip(300, 0);
+    set_t world{bear, vip};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(vip, flee(vip, world));
+    scheduler.tick();
+    scheduler.tick();
+
+    ASSERT_EQ(vip->position(), std::make_pair(300, 0)) << "Далёкая угроза не должна будить Выпь.";
+
+    scheduler.spawn(bear, hunt(bear, world));
+    for (int i = 0; i < 100; ++i) {
+        scheduler.tick();
+    }
+    ASSERT_GT(vip->position().first, 300) << "Проснувшись, Выпь должна убегать от Медведя.";
+}
+
+TEST_F(FightTest, Behaviour_DeadNpcIsReleased) {
+    auto bear = createBear(0, 0);
+    auto vihuhol = createVihuhol(50, 50);
+    set_t world{bear, vihuhol};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(bear, hunt(bear, world));
+    scheduler.spawn(vihuhol, hunt(vihuhol, world));
+    scheduler.tick();
+    ASSERT_EQ(scheduler.active(), 2u);
+
+    bear->die();
+    scheduler.tick();
+    ASSERT_EQ(scheduler.active(), 1u);
+}
+
+TEST_F(FightTest, Behaviour_BatchedStepsMatchScalarMove) {
+    // Планировщик считает шаги пачкой (fixed_step_batch). Каждый NPC должен
+    // прийти туда же, куда его привёл бы шаг, посчитанный по одному через
+    // fixed_step, - так ходил старый NPC::move.
+    set_t world;
+    // Сетка со сдвигами: ни одна пара не стоит в одной точке, и
+    // направления на ближайшего соседа разные.
+    for (int i = 0; i < (int)BEHAVIOUR_BATCH + 100; ++i) {
+        world.insert(createBear((i % 34) * 11 + (i * 7) % 5, (i / 34) * 11 + (i * 3) % 5));
+    }
+    BehaviourScheduler scheduler;
+    for (const auto &npc : world) {
+        scheduler.spawn(npc, hunt(npc, world));
+    }
+
+    for (int tick = 0; tick < 3; ++tick) {
+        std::map<size_t, std::pair<int, int>> expected;
+        for (const auto &npc : world) {
+            auto [x, y] = npc->position();
+            auto [tx, ty] = npc->nearest(world)->position();
+            auto [dx, dy] = fixed_step(tx - x, ty - y, (int)npc->get_speed());
+            expected[npc->get_id()] = {std::clamp(x + dx, 0, (int)MAP_SIZE), std::clamp(y + dy, 0, (int)MAP_SIZE)};
+        }
+
+        scheduler.tick();
+
+        for (const auto &npc : world) {
+            ASSERT_EQ(npc->position(), expected[npc->get_id()]) << "тик " << tick;
+        }
+    }
+}
+
+TEST_F(FightTest, Behaviour_PoolMatchesInline) {
+    // Несколько пачек: ход каждого NPC должен зависеть только от позиций
+    // прошлого тика, а не от того, какие пачки уже успели отработать.
+    auto make_world = [this] {
+        set_t world;
+        for (int i = 0; i < (int)BEHAVIOUR_BATCH + 100; ++i) {
+            world.insert(createVihuhol((i * 37) % MAP_SIZE, (i * 91) % MAP_SIZE));
+        }
+        return world;
+    };
+    auto run = [](set_t &world, ThreadPool *pool) {
+        BehaviourScheduler scheduler;
+        for (const auto &npc : world) {
+            scheduler.spawn(npc, hunt(npc, world));
+        }
+        for (int i = 0; i < 3; ++i) {
+            scheduler.tick(pool);
+        }
+        std::map<size_t, std::pair<int, int>> byId;
+        for (const auto &npc : world) {
+            byId[npc->get_id()] = npc->position();
+        }
+        std::vector<std::pair<int, int>> result;
+        for (const auto &[id, position] : byId) {
+            result.push_back(position);
+        }
+        return result;
+    };
+
+    set_t inlineWorld = make_world();
+    set_t pooledWorld = make_world();
+    ThreadPool pool(2);
+    ASSERT_EQ(run(inlineWorld, nullptr), run(pooledWorld, &pool));
+}
+
+// =====================================================================
+// ТЕСТЫ ЦЕЛОЧИСЛЕННОЙ КИНЕМАТИКИ
+// =====================================================================
+
+TEST(KinematicsTest, CloseToFloatingPoint) {
+    for (int dx = -60; dx <= 60; dx += 7) {
+        for (int dy = -60; dy <= 60; dy += 5) {
+            double angle = std::atan2((double)dy, (double)dx);
+            auto [sx, sy] = fixed_step(dx, dy, 50);
+
+            ASSERT_LE(std::abs(sx - (int)(std::cos(angle) * 50)), 1) << dx << " " << dy;
+            ASSERT_LE(std::abs(sy - (int)(std::sin(angle) * 50)), 1) << dx << " " << dy;
+        }
+    }
+}
+
+TEST(KinematicsTest, BatchMatchesScalar) {
+    std::vector<int> dx, dy, speed;
+    for (int i = -40; i <= 40; ++i) {
+        dx.push_back(i * 3);
+        dy.push_back(100 - i * i);
+        speed.push_back(i % 2 ? 5 : 50);
+    }
+    dx.insert(dx.end(), {0, 1, -1, 1000000, INT_MAX, -INT_MAX, 7});
+    dy.insert(dy.end(), {0, 0, 1, -999999, INT_MAX - 1, 3, -INT_MAX});
+    speed.insert(speed.end(), {5, 5, 50, 50, 50, INT_MAX / FIXED_ONE, 5});
+
+    std::vector<int> outX(dx.size()), outY(dx.size());
+    fixed_step_batch(dx.data(), dy.data(), speed.data(), outX.data(), outY.data(), dx.size());
+
+    for (size_t i = 0; i < dx.size(); ++i) {
+        ASSERT_EQ(std::make_pair(outX[i], outY[i]), fixed_step(dx[i], dy[i], speed[i])) << dx[i] << " " << dy[i];
+    }
+}
+
+// =====================================================================
+// ТЕСТЫ ОСТРОВОВ АКТИВНОСТИ
+// =====================================================================
+
+TEST_F(FightTest, Activity_ContactBound) {
+    auto vip1 = createVip(0, 0);
+    auto vip2 = createVip(5, 0);
+    ASSERT_EQ(ticks_to_contact(*vip1, *vip2), NO_CONTACT) << "Выпи не могут убить друг друга.";
+
+    auto bear = createBear(0, 0);
+    auto vihuhol = createVihuhol(300, 0);
+    // Зазор 300 - 20 (дальность Выхухоли), сближение не быстрее 5 + 5 за тик.
+    ASSERT_EQ(ticks_to_contact(*bear, *vihuhol), 28u);
+    ASSERT_EQ(ticks_to_contact(*vihuhol, *bear), 28u);
+
+    ASSERT_EQ(sleep_ticks_for(SLEEP_MIN_TICKS - 1), 0u);
+    ASSERT_EQ(sleep_ticks_for(NO_CONTACT), SLEEP_MAX_TICKS);
+}
+
+TEST_F(FightTest, Activity_SleepingNpcDoesNotMoveUntilWoken) {
+    auto bear = createBear(0, 0);
+    auto vip = createVip(100, 0);
+    set_t world{bear, vip};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(bear, hunt(bear, world));
+    bear->sleep_until(10);
+
+    for (int i = 0; i < 5; ++i) {
+        scheduler.tick();
+    }
+    ASSERT_EQ(bear->position(), std::make_pair(0, 0));
+
+    scheduler.wake(*bear);
+    scheduler.tick();
+    ASSERT_EQ(bear->position(), std::make_pair(5, 0));
+}
+
+TEST_F(FightTest, TickExecutor_MoveTimeExcludesPreviousTick) {
+    auto bear = createBear(0, 0);
+    auto vip = createVip(200, 200);
+    set_t world{bear, vip};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(bear, hunt(bear, world));
+    scheduler.spawn(vip, flee(vip, world));
+    ThreadPool pool(2);
+    // Отрисовка прошлого тика долгая, а движение двух NPC - мгновенное.
+    TickExecutor executor(world, scheduler, pool, [] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+
+    executor.run_tick();
+    executor.run_tick();
+    ASSERT_LT(phaseTimings.moveUs, 50000u);
+    ASSERT_GE(phaseTimings.renderUs, 50000u);
+    executor.finish();
+}
+
+TEST_F(FightTest, Activity_SleepDoesNotDelayContact) {
+    // Одна и та же дальняя пара: через TickExecutor (с поиском целей и сном)
+    // и голым планировщиком. Сближение должно случиться на том же тике.
+    auto contact_tick = [this](bool executor) {
+        auto bear = createBear(0, 0);
+        auto vihuhol = createVihuhol(300, 0);
+        set_t world{bear, vihuhol};
+
+        BehaviourScheduler scheduler;
+        scheduler.spawn(bear, hunt(bear, world));
+        scheduler.spawn(vihuhol, hunt(vihuhol, world));
+        ThreadPool pool(2);
+        TickExecutor tickExecutor(world, scheduler, pool, {});
+
+        for (size_t tick = 1; tick <= 100; ++tick) {
+            if (executor) {
+                tickExecutor.run_tick();
+            } else {
+                scheduler.tick();
+            }
+            if (vihuhol->is_close(bear)) return tick;
+        }
+        return size_t{0};
+    };
+
+    size_t expected = contact_tick(false);
+    ASSERT_GT(expected, 0u);
+    ASSERT_EQ(contact_tick(true), expected);
+}
+
+TEST_F(FightTest, Activity_IdleNpcSleepsUnderExecutor) {
+    auto vip1 = createVip(0, 0);
+    auto vip2 = createVip(300, 300);
+    set_t world{vip1, vip2};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(vip1, flee(vip1, world));
+    scheduler.spawn(vip2, flee(vip2, world));
+    ThreadPool pool(1);
+    TickExecutor executor(world, scheduler, pool, {});
+
+    // Угроз нет: поведение само ждёт, и поиск целей его не будит.
+    executor.run_tick();
+    ASSERT_TRUE(vip1->is_sleeping(scheduler.current_tick()));
+    ASSERT_LE(vip1->sleeping_until(), scheduler.resumes_at(*vip1));
+    executor.finish();
+}
+
+// =====================================================================
+// ТЕСТЫ ГРАФА ЗАДАЧ
+// =====================================================================
+
+TEST(TaskGraphTest, RespectsDependencies) {
+    ThreadPool pool(4);
+    std::mutex mtx;
+    std::vector<int> order;
+    auto record = [&](int v) {
+        return [&, v] {
+            std::lock_guard<std::mutex> lock(mtx);
+            order.push_back(v);
+        };
+    };
+
+    TaskGraph graph;
+    auto first = graph.add(record(1));
+    auto left = graph.add(record(2), {first});
+    auto right = graph.add(record(2), {first});
+    graph.add(record(3), {left, right});
+    graph.run(pool);
+
+    ASSERT_EQ(order, (std::vector<int>{1, 2, 2, 3}));
+}
+
+TEST(TaskGraphTest, RunsManyIndependentTasks) {
+    ThreadPool pool(4);
+    std::atomic<int> sum{0};
+
+    for (int round = 0; round < 3; ++round) {
+        TaskGraph graph;
+        std::vector<TaskGraph::task_id> parts;
+        for (int i = 1; i <= 100; ++i) {
+            parts.push_back(graph.add([&sum, i] { sum += i; }));
+        }
+        graph.add([&sum] { sum += 1; }, parts);
+        graph.run(pool);
+    }
+
+    ASSERT_EQ(sum, 3 * (5050 + 1));
+}
+
+TEST_F(FightTest, TickExecutor_RenderSeesCommittedPositions) {
+    set_t world;
+    for (int i = 0; i < 300; ++i) {
+        if (i % 3 == 0) world.insert(createBear((i * 37) % MAP_SIZE, (i * 91) % MAP_SIZE));
+        else if (i % 3 == 1) world.insert(createVip((i * 53) % MAP_SIZE, (i * 17) % MAP_SIZE));
+        else world.insert(createVihuhol((i * 71) % MAP_SIZE, (i * 29) % MAP_SIZE));
+    }
+
+    using positions_t = std::map<size_t, std::pair<int, int>>;
+    auto positions = [&world] {
+        positions_t result;
+        for (const auto &npc : world) {
+            result[npc->get_id()] = npc->position();
+        }
+        return result;
+    };
+
+    BehaviourScheduler scheduler;
+    for (const auto &npc : world) {
+        scheduler.spawn(npc, default_behaviour(npc, world));
+    }
+
+    // Отрисовка тика N идёт вместе с движением тика N + 1, но должна видеть
+    // ровно те позиции, которыми закончился тик N. Пауза отдаёт процессор
+    // остальным задачам тика даже на одном ядре.
+    std::vector<positions_t> drawn;
+    std::vector<positions_t> committed{positions()};
+    ThreadPool pool(4);
+    TickExecutor executor(world, scheduler, pool, [&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        drawn.push_back(positions());
+    });
+
+    for (int i = 0; i < 10; ++i) {
+        executor.run_tick();
+        committed.push_back(positions());
+    }
+    executor.finish();
+
+    ASSERT_EQ(drawn.size(), 10u);
+    for (size_t i = 0; i < drawn.size(); ++i) {
+        ASSERT_EQ(drawn[i], committed[i]) << "Тик " << i;
+    }
+
+    DensitySnapshot density = densityMap.load();
+    int counted = 0;
+    for (uint16_t cell : density.cells) {
+        counted += cell;
+    }
+    int alive = std::count_if(world.begin(), world.end(), [](const auto &npc) { return npc->is_alive(); });
+    ASSERT_EQ(counted, alive);
+    ASSERT_EQ(density.tick, scheduler.current_tick());
+}
+
+// =====================================================================
+// ТЕСТЫ СОБЫТИЙНОГО РЕЖИМА
+// =====================================================================
+
+TEST_F(FightTest, Events_NoEnemiesNoEvents) {
+    auto vip1 = createVip(0, 0);
+    auto vip2 = createVip(5, 0);
+    set_t world{vip1, vip2};
+
+    BehaviourScheduler scheduler;
+    EventEngine engine(world, scheduler);
+
+    ASSERT_EQ(engine.run_until(20), 0u);
+    ASSERT_EQ(engine.pending(), 0u);
+    ASSERT_EQ(scheduler.current_tick(), 20u);
+}
+
+TEST_F(FightTest, Events_FarPairIsSkippedUntilPredictedContact) {
+    auto bear = createBear(0, 0);
+    auto vihuhol = createVihuhol(300, 0);
+    set_t world{bear, vihuhol};
+
+    BehaviourScheduler scheduler;
+    scheduler.spawn(bear, hunt(bear, world));
+    scheduler.spawn(vihuhol, hunt(vihuhol, world));
+    EventEngine engine(world, scheduler);
+
+    // Сближение не раньше чем через 28 тиков - до этого событий нет.
+    ASSERT_EQ(engine.run_until(20), 0u);
+    ASSERT_EQ(bear->position(), std::make_pair(100, 0)) << "Между событиями мир всё равно движется.";
+
+    engine.run_until(60);
+    ASSERT_FALSE(bear->is_alive() && vihuhol->is_alive() && bear->distance(vihuhol) > 20)
+        << "Сошедшаяся пара должна была встретиться.";
+}
+
+// =====================================================================
+// ТЕСТЫ ПАКЕТНЫХ БОЁВ
+// =====================================================================
+
+TEST_F(FightTest, Batch_KillTableMatchesVisitor) {
+    std::vector<std::shared_ptr<NPC>> all{createBear(), createVip(), createVihuhol()};
+    for (const auto &attacker : all) {
+        for (const auto &defender : all) {
+            ASSERT_EQ(can_kill(attacker->get_type(), defender->get_type()), defender->accept(attacker))
+                << attacker->get_type() << " -> " << defender->get_type();
+        }
+    }
+}
+
+TEST_F(FightTest, Batch_DiceAreInRange) {
+    std::vector<int> dice(6000);
+    roll_dice_batch(dice.data(), dice.size());
+
+    std::array<int, 6> seen{};
+    for (int d : dice) {
+        ASSERT_GE(d, 0);
+        ASSERT_LT(d, 6);
+        seen[d]++;
+    }
+    for (int count : seen) {
+        ASSERT_GT(count, 700) << "Кубик должен быть примерно равномерным.";
+    }
+}
+
+TEST_F(FightTest, Batch_HarmlessPairsNeverKill) {
+    auto vip = createVip();
+    auto bear = createBear();
+    auto vihuhol = createVihuhol();
+    std::vector<BattleTask> tasks(50, BattleTask{vip, bear});
+    tasks.insert(tasks.end(), 50, BattleTask{vihuhol, vip});
+
+    completeBattles(tasks);
+
+    ASSERT_TRUE(bear->is_alive());
+    ASSERT_TRUE(vip->is_alive());
+}
+
+TEST_F(FightTest, Batch_DefenderDiesOnce) {
+    auto vip = createVip();
+    std::vector<std::shared_ptr<Bear>> bears;
+    std::vector<BattleTask> tasks;
+    for (int i = 0; i < 64; ++i) {
+        bears.push_back(createBear());
+        tasks.push_back({bears.back(), vip});
+    }
+
+    auto obs = std::make_shared<MockObserver>();
+    fightObservers.subscribe(obs, type_bit(BearType), WinEvent);
+    size_t killsBefore = populationStats.kills(BearType);
+
+    completeBattles(tasks);
+
+    // Шанс, что ни один из 64 медведей не выиграл бросок, пренебрежимо мал.
+    ASSERT_FALSE(vip->is_alive());
+    ASSERT_EQ(obs->callCount, 1);
+    ASSERT_EQ(populationStats.kills(BearType), killsBefore + 1);
+}
+
+// =====================================================================
+// ТЕСТЫ КОНТРОЛЬНЫХ ТОЧЕК
+// =====================================================================
+
+TEST_F(FightTest, Checkpoint_DeltaHoldsOnlyChangedNpcs) {
+    std::string path = ::testing::TempDir() + "checkpoint_delta.txt";
+    auto bear = createBear(0, 0);
+    auto vip = createVip(100, 100);
+    auto vihuhol = createVihuhol(200, 200);
+    set_t world{bear, vip, vihuhol};
+
+    Checkpointer checkpointer(path);
+    checkpointer.write_base(world);
+
+    bear->step_towards(100, 0);
+    bear->step_towards(100, 0);
+    bear->commit_position();
+    vip->die();
+
+    ASSERT_EQ(checkpointer.write_delta(1), 2u) << "Выхухоль не менялась и в дельту попасть не должна.";
+    ASSERT_EQ(checkpointer.write_delta(2), 0u);
+
+    auto records = Checkpointer::restore(path);
+    ASSERT_EQ(records.size(), 2u);
+    for (const auto &r : records) {
+        if (r.type == BearType) {
+            ASSERT_EQ(std::make_pair(r.x, r.y), std::make_pair(10, 0));
+        } else {
+            ASSERT_EQ(r.type, VihuholType);
+        }
+    }
+}
+
+TEST_F(FightTest, Checkpoint_CompactionKeepsState) {
+    std::string path = ::testing::TempDir() + "checkpoint_compact.txt";
+    auto bear = createBear(0, 0);
+    set_t world{bear};
+
+    Checkpointer checkpointer(path);
+    checkpointer.write_base(world);
+
+    for (size_t tick = 1; tick <= 2 * COMPACT_AFTER; ++tick) {
+        bear->step_towards(400, 0);
+        bear->commit_position();
+        checkpointer.write_delta(tick);
+    }
+    checkpointer.wait_compaction();
+
+    auto records = Checkpointer::restore(path);
+    ASSERT_EQ(records.size(), 1u);
+    ASSERT_EQ(records[0].x, bear->position().first);
+}
+
+TEST_F(FightTest, Checkpoint_NewRunIgnoresOldSegments) {
+    std::string path = ::testing::TempDir() + "checkpoint_runs.txt";
+    auto bear = createBear(0, 0);
+    set_t firstRun{bear};
+    {
+        Checkpointer checkpointer(path);
+        checkpointer.write_base(firstRun);
+        for (size_t tick = 1; tick <= 3; ++tick) {
+            bear->step_towards(400, 0);
+            bear->commit_position();
+            checkpointer.write_delta(tick);
+        }
+    }
+
+    // Новый запуск: его первая дельта не должна потянуть за собой
+    // вторую и третью дельты прошлого.
+    auto vip = createVip(100, 100);
+    set_t secondRun{vip};
+    Checkpointer checkpointer(path);
+    checkpointer.write_base(secondRun);
+    vip->step_towards(0, 100);
+    vip->commit_position();
+    checkpointer.write_delta(1);
+
+    auto records = Checkpointer::restore(path);
+    ASSERT_EQ(records.size(), 1u);
+    ASSERT_EQ(records[0].type, VipType);
+    ASSERT_EQ(std::make_pair(records[0].x, records[0].y), vip->position());
+}
+
+// =====================================================================
+// ТЕСТЫ ЖУРНАЛА БОЁВ
+// =====================================================================
+
+TEST(FightLogTest, QuerySkipsBlocksByIndex) {
+    std::string path = ::testing::TempDir() + "fights_query.log";
+    std::remove(path.c_str());
+
+    {
+        FightLogWriter writer(path);
+        // Три блока: тики 0..1023, 1024..2047, 2048..3071; Медведи только во втором.
+        for (uint32_t i = 0; i < 3 * FIGHT_LOG_BLOCK; ++i) {
+            bool second = i >= FIGHT_LOG_BLOCK && i < 2 * FIGHT_LOG_BLOCK;
+            writer.append({i, i, i + 1,
+                           (uint8_t)(second ? BearType : VihuholType), (uint8_t)VipType, 1,
+                           0, 0, (int16_t)(i % 400), (int16_t)(i % 400)});
+        }
+    }
+
+    FightQuery query;
+    query.attacker = BearType;
+    query.minX = 0;
+    query.maxX = 99;
+    query.minY = 0;
+    query.maxY = 99;
+    auto result = query_fight_log(path, query);
+
+    ASSERT_EQ(result.blocksTotal, 3u);
+    ASSERT_EQ(result.blocksRead, 1u);
+    for (const auto &r : result.records) {
+        ASSERT_EQ(r.attackerType, BearType);
+        ASSERT_LT(r.defenderX, 100);
+    }
+    ASSERT_EQ(result.records.size(), 248u);
+
+    query = FightQuery{};
+    query.fromTick = 2500;
+    query.toTick = 2600;
+    result = query_fight_log(path, query);
+    ASSERT_EQ(result.blocksRead, 1u);
+    ASSERT_EQ(result.records.size(), 101u);
+}
+
+TEST_F(FightTest, FightLog_PositionsAreFromDetection) {
+    std::string path = ::testing::TempDir() + "fights_positions.log";
+    std::remove(path.c_str());
+
+    auto bear = createBear(0, 0);
+    auto vip = createVip(0, 5);
+    BattleTask task{bear, vip};
+
+    // Между обнаружением боя и его разрешением участники успели сдвинуться.
+    bear->step_towards(400, 0);
+    bear->commit_position();
+    vip->step_towards(0, 400);
+    vip->commit_position();
+
+    auto log = std::make_shared<FightLogObserver>(path);
+    fightObservers.subscribe(log);
+    completeBattles({task});
+    log->flush();
+
+    auto result = query_fight_log(path, FightQuery{});
+    ASSERT_EQ(result.records.size(), 1u);
+    ASSERT_EQ(std::make_pair((int)result.records[0].attackerX, (int)result.records[0].attackerY), std::make_pair(0, 0));
+    ASSERT_EQ(std::make_pair((int)result.records[0].defenderX, (int)result.records[0].defenderY), std::make_pair(0, 5));
+
+    FightQuery query;
+    query.outcome = 2;
+    ASSERT_TRUE(query_fight_log(path, query).records.empty()) << "Исходов, кроме 0 и 1, не бывает.";
+}
+
+TEST(FightLogTest, TextRendererMatchesOldLog) {
+    std::ostringstream os;
+    render_text(os, {7, 1, 2, BearType, VipType, 1, 10, 20, 30, 40});
+    ASSERT_EQ(os.str(), "{ x:10, y:20}  убивает { x:30, y:40} \n");
+}
+
+// =====================================================================
+// ТЕСТЫ КОМАНД ТОЧКИ СТАТИСТИКИ
+// =====================================================================
+
+TEST(StatsServerTest, StatsReportPopulation) {
+    std::string reply = handle_command("stats");
+    std::string expected = "alive_total=" + std::to_string(populationStats.alive_total()) + "\n";
+    ASSERT_NE(reply.find(expected), std::string::npos) << reply;
+    ASSERT_NE(reply.find("queue_depth="), std::string::npos);
+}
+
+TEST(StatsServerTest, DensityReplyIsOneTick) {
+    // Писатель публикует карты, где каждая клетка равна номеру тика; в ответе
+    // не должно быть клеток от другого тика, чем в заголовке.
+    densityMap.store({});
+    std::jthread writer([](std::stop_token stop) {
+        for (size_t tick = 1; !stop.stop_requested(); ++tick) {
+            DensitySnapshot density{tick, {}};
+            density.cells.fill((uint16_t)tick);
+            densityMap.store(density);
+        }
+    });
+
+    for (int i = 0; i < 2000; ++i) {
+        std::istringstream reply(handle_command("density"));
+        std::string header;
+        reply >> header;
+        ASSERT_EQ(header.rfind("tick=", 0), 0u) << header;
+        size_t tick = std::stoull(header.substr(5));
+
+        unsigned cell;
+        while (reply >> cell) {
+            ASSERT_EQ(cell, (uint16_t)tick);
+        }
+    }
+
+    writer.request_stop();
+    writer.join();
+    densityMap.store({});
+}
+
+TEST(StatsServerTest, ClientLeavingEarlyDoesNotKillServer) {
+    std::string path = ::testing::TempDir() + "stats_test.sock";
+    StatsServer server(path);
+    ASSERT_TRUE(server.start());
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, path.size());
+    auto request = [&addr](bool waitForReply) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            ::close(fd);
+            return std::string("connect failed");
+        }
+        std::string command = "density\n";
+        ::send(fd, command.data(), command.size(), MSG_NOSIGNAL);
+
+        std::string reply;
+        char buf[4096];
+        ssize_t n;
+        while (waitForReply && (n = ::read(fd, buf, sizeof(buf))) > 0) {
+            reply.append(buf, n);
+        }
+        ::close(fd);
+        return reply;
+    };
+
+    // Клиенты уходят, не дочитав ответ: раньше это убивало процесс SIGPIPE.
+    for (int i = 0; i < 50; ++i) {
+        request(false);
+    }
+    ASSERT_EQ(request(true).rfind("tick=", 0), 0u);
+    server.stop();
+}
+
+TEST(StatsServerTest, ControlCommands) {
+    ASSERT_EQ(handle_command("pause"), "ok\n");
+    ASSERT_TRUE(simulationControl.paused);
+    ASSERT_EQ(handle_command("resume"), "ok\n");
+    ASSERT_FALSE(simulationControl.paused);
+
+    ASSERT_EQ(handle_command("rate 250"), "ok\n");
+    ASSERT_EQ(simulationControl.tickPeriodMs, 250);
+    ASSERT_NE(handle_command("rate -1").find("error"), std::string::npos);
+    ASSERT_EQ(simulationControl.tickPeriodMs, 250);
+    simulationControl.tickPeriodMs = 1000;
+
+    ASSERT_EQ(handle_command("snapshot"), "ok\n");
+    ASSERT_TRUE(simulationControl.snapshotRequested.exchange(false));
+}
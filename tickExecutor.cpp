@@ -0,0 +1,178 @@
+#include "tickExecutor.h"
+#include "activity.h"
+#include <algorithm>
+
+PhaseTimings phaseTimings;
+SeqLock<DensitySnapshot> densityMap;
+
+static uint64_t micros_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+TickExecutor::TickExecutor(set_t &npcs, BehaviourScheduler &scheduler, ThreadPool &pool, std::function<void()> render)
+    : npcs(npcs), scheduler(scheduler), pool(pool), render(std::move(render)) {}
+
+// Пачки ждут чужие задачи графа, поэтому время движения - это сумма времени
+// самих пачек и commit(), а не время от постройки графа.
+void TickExecutor::move_batch(size_t batch)
+{
+    auto start = clock::now();
+    scheduler.resume_batch(batch);
+    moveUs += micros_since(start);
+}
+
+void TickExecutor::commit_moves()
+{
+    auto start = clock::now();
+    scheduler.commit();
+    phaseTimings.moveUs = moveUs + micros_since(start);
+    detectStart = clock::now();
+}
+
+void TickExecutor::detect(size_t chunk, size_t tick)
+{
+    DetectChunk &out = chunks[chunk];
+    size_t from = chunk * DETECT_CHUNK;
+    size_t to = std::min(order.size(), from + DETECT_CHUNK);
+
+    for (size_t i = from; i < to; ++i) {
+        const auto &attacker = *order[i];
+        if (!attacker->is_alive() || attacker->is_sleeping(tick)) continue;
+
+        size_t quiet = NO_CONTACT;
+        for (const auto &defender : npcs) {
+            if (attacker.get() == defender.get() || !defender->is_alive()) continue;
+
+            if (attacker->is_close(defender)) {
+                out.tasks.push_back({attacker, defender});
+            }
+
+            size_t contact = ticks_to_contact(*attacker, *defender);
+            quiet = std::min(quiet, contact);
+            if (contact <= 1 && defender->is_sleeping(tick)) {
+                out.wakes.push_back(defender.get());
+            }
+        }
+
+        // Сон не длиннее паузы, которую корутина взяла сама: уснуть может
+        // только тот, кто и так не ходит, и погоня сном не прерывается.
+        if (size_t sleep = sleep_ticks_for(quiet)) {
+            attacker->sleep_until(std::min(tick + sleep, scheduler.resumes_at(*attacker)));
+        }
+    }
+}
+
+void TickExecutor::merge()
+{
+    queuedThisTick = 0;
+    for (auto &chunk : chunks) {
+        for (NPC *npc : chunk.wakes) {
+            scheduler.wake(*npc);
+        }
+
+        std::lock_guard<std::mutex> tasks_lock(battleTasksMutex);
+        for (auto &task : chunk.tasks) {
+            battleTasks.push(std::move(task));
+        }
+        queuedThisTick += chunk.tasks.size();
+        phaseTimings.queueDepth = battleTasks.size();
+    }
+    phaseTimings.detectUs = micros_since(detectStart);
+}
+
+void TickExecutor::battle(size_t count)
+{
+    auto start = clock::now();
+    std::vector<BattleTask> tasks;
+    tasks.reserve(count);
+    {
+        std::lock_guard<std::mutex> tasks_lock(battleTasksMutex);
+        for (size_t i = 0; i < count; ++i) {
+            tasks.push_back(std::move(battleTasks.front()));
+            battleTasks.pop();
+        }
+        phaseTimings.queueDepth = battleTasks.size();
+    }
+    completeBattles(tasks);
+    phaseTimings.battleUs = micros_since(start);
+}
+
+void TickExecutor::draw()
+{
+    auto start = clock::now();
+    if (render) render();
+    phaseTimings.renderUs = micros_since(start);
+}
+
+void TickExecutor::publish(size_t tick)
+{
+    DensitySnapshot density{tick, {}};
+    const int step = (int)MAP_SIZE / DENSITY_GRID;
+
+    for (const auto &npc : npcs) {
+        if (!npc->is_alive()) continue;
+        auto [x, y] = npc->position();
+        int i = std::min(x / step, DENSITY_GRID - 1);
+        int j = std::min(y / step, DENSITY_GRID - 1);
+        ++density.cells[i + DENSITY_GRID * j];
+    }
+
+    densityMap.store(density);
+    phaseTimings.tick = tick;
+}
+
+void TickExecutor::run_tick()
+{
+    // Состав set_t внутри тика не меняется, поэтому куски поиска можно
+    // разметить заранее.
+    order.clear();
+    for (const auto &npc : npcs) {
+        order.push_back(&npc);
+    }
+    chunks.assign((order.size() + DETECT_CHUNK - 1) / DETECT_CHUNK, {});
+
+    size_t tick = scheduler.current_tick() + 1;
+    size_t previous = queuedLastTick;
+
+    TaskGraph graph;
+
+    auto battles = graph.add([this, previous, tick] {
+        battleTick = tick - 1;
+        battle(previous);
+    });
+    auto drawn = graph.add([this] { draw(); }, {battles});
+    auto published = graph.add([this, tick] { publish(tick - 1); }, {battles, drawn});
+
+    // Пачки движения выбирают цели по is_alive(), поэтому идут после боёв
+    // прошлого тика - иначе выбор зависел бы от того, кто успел умереть.
+    // Позиции они читают прошлого тика, а пишут в буфер следующего, так что
+    // идут параллельно друг с другом и с отрисовкой и публикацией. А вот
+    // commit_moves() меняет позиции, которые те читают, поэтому ждёт их.
+    moveUs = 0;
+    std::vector<TaskGraph::task_id> steps{battles, drawn, published};
+    for (size_t b = 0, batches = scheduler.prepare(); b < batches; ++b) {
+        steps.push_back(graph.add([this, b] { move_batch(b); }, {battles}));
+    }
+    auto moved = graph.add([this] { commit_moves(); }, steps);
+    std::vector<TaskGraph::task_id> detected;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        detected.push_back(graph.add([this, c, tick] { detect(c, tick); }, {moved}));
+    }
+    graph.add([this] { merge(); }, detected);
+
+    graph.run(pool);
+    queuedLastTick = queuedThisTick;
+}
+
+void TickExecutor::finish()
+{
+    TaskGraph graph;
+    auto battles = graph.add([this] {
+        battleTick = scheduler.current_tick();
+        battle(queuedLastTick);
+    });
+    graph.add([this] { publish(scheduler.current_tick()); }, {battles});
+    graph.run(pool);
+    queuedLastTick = 0;
+}
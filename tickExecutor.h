@@ -0,0 +1,85 @@
+#pragma once
+#include "npc.h"
+#include "battleManager.h"
+#include "behaviour.h"
+#include "taskGraph.h"
+#include "seqlock.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+constexpr size_t DETECT_CHUNK = 256;
+
+// Длительность фаз последнего тика в микросекундах. moveUs - сумма времени
+// пачек движения и commit(): ожидание боёв прошлого тика в неё не входит.
+struct PhaseTimings
+{
+    std::atomic<uint64_t> moveUs{0};
+    std::atomic<uint64_t> detectUs{0};
+    std::atomic<uint64_t> battleUs{0};
+    std::atomic<uint64_t> renderUs{0};
+    std::atomic<size_t> queueDepth{0};
+    std::atomic<size_t> tick{0};
+};
+
+// Огрублённая карта плотности: сколько живых NPC в каждой клетке DENSITY_GRID x DENSITY_GRID.
+constexpr int DENSITY_GRID = 20;
+
+struct DensitySnapshot
+{
+    size_t tick;
+    std::array<uint16_t, DENSITY_GRID * DENSITY_GRID> cells;
+};
+
+// Состояние, которое публикуется каждый тик и читается без npcMutex.
+// Карта плотности публикуется целиком, так что клетки разных тиков в одном
+// чтении не смешиваются.
+extern PhaseTimings phaseTimings;
+extern SeqLock<DensitySnapshot> densityMap;
+
+// Тик как граф задач: бои прошлого тика -> движение пачками -> поиск целей
+// кусками -> слияние результатов. Отрисовка и публикация прошлого тика идут
+// на пуле параллельно с пачками движения и заканчиваются до того, как новые
+// позиции станут видны.
+class TickExecutor
+{
+public:
+    TickExecutor(set_t &npcs, BehaviourScheduler &scheduler, ThreadPool &pool, std::function<void()> render);
+
+    // Вызывать под std::shared_lock на npcMutex.
+    void run_tick();
+    // Доигрывает бои и отрисовку последнего тика.
+    void finish();
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct DetectChunk
+    {
+        std::vector<BattleTask> tasks;
+        std::vector<NPC *> wakes;
+    };
+
+    void move_batch(size_t batch);
+    void commit_moves();
+    void detect(size_t chunk, size_t tick);
+    void merge();
+    void battle(size_t count);
+    void draw();
+    void publish(size_t tick);
+
+    set_t &npcs;
+    BehaviourScheduler &scheduler;
+    ThreadPool &pool;
+    std::function<void()> render;
+
+    std::vector<const std::shared_ptr<NPC> *> order;
+    std::vector<DetectChunk> chunks;
+    size_t queuedLastTick{0};
+    size_t queuedThisTick{0};
+    std::atomic<uint64_t> moveUs{0};
+    clock::time_point detectStart;
+};